@@ -0,0 +1,113 @@
+#include "server.hpp"
+#include "client.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+    请求路径在事件循环线程上的堆分配次数，用计数的operator new统计，防止池化和arena之后分配数回升
+    用法: alloc_bench [--port=8095] [--requests=10000] [--max=18]
+    进程内启动一个Server(构造时需要本机Redis)，计算服务的标量方法指定为内联执行，
+    用RPCClient逐个调用(每次调用新建连接)，只统计事件循环线程上的分配；
+    任一方法的平均分配次数超过max时返回1。剩余的分配都来自nlohmann::json解析请求
+*/
+
+static thread_local bool counting = false;
+static std::atomic<uint64_t> allocations{0};
+
+static void* countedAlloc(size_t size, size_t alignment) {
+    if (counting) allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        p = malloc(size ? size : 1);
+    } else if (posix_memalign(&p, alignment, size ? size : 1) != 0) {
+        p = nullptr;
+    }
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return countedAlloc(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, std::align_val_t alignment) {
+    return countedAlloc(size, static_cast<size_t>(alignment));
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+
+struct BenchOptions {
+    int port = 8095;
+    size_t requests = 10000;
+    long max = 18;
+};
+
+static BenchOptions parseOptions(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = eq == std::string::npos ? arg : arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+        if (key == "--port") options.port = std::atoi(value.c_str());
+        else if (key == "--requests") options.requests = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "--max") options.max = std::atol(value.c_str());
+        else {
+            fprintf(stderr, "usage: alloc_bench [--port=] [--requests=] [--max=]\n");
+            exit(2);
+        }
+    }
+    return options;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options = parseOptions(argc, argv);
+    const std::vector<std::string> methods = {"add", "sub", "mul", "div"};
+
+    trpc::ServerOptions server_options;
+    server_options.trace_sample_rate = 0;
+    server_options.idle_timeout = std::chrono::milliseconds(0);
+    trpc::Server server(options.port, server_options);
+    server.registerService("compute", std::make_unique<trpc::ComputeService<int>>());
+    for (const std::string& method : methods) {
+        server.setExecutionMode("compute", method, trpc::ExecutionMode::Inline);
+    }
+    std::thread loop([&server] {
+        counting = true;
+        server.start();
+    });
+
+    ClientOptions client_options;
+    client_options.auto_batch = false;
+    RPCClient client("127.0.0.1", options.port, client_options);
+    auto run = [&](const std::string& method, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            client.callAsync<int>("compute", method, std::vector<int>{static_cast<int>(i), 3}).get();
+        }
+    };
+
+    bool ok = true;
+    printf("%-10s %16s\n", "method", "allocs/request");
+    for (const std::string& method : methods) {
+        // 预热：池中的对象、arena和缓冲区在最初的请求中分配
+        run(method, 1000);
+        uint64_t before = allocations.load(std::memory_order_relaxed);
+        run(method, options.requests);
+        double per_request = static_cast<double>(allocations.load(std::memory_order_relaxed) - before)
+                             / options.requests;
+        // 偶尔的容器扩容摊到每个请求上不足一次，按四舍五入后的次数比较
+        bool within = std::lround(per_request) <= options.max;
+        printf("%-10s %16.2f%s\n", method.c_str(), per_request, within ? "" : "  (over limit)");
+        ok = ok && within;
+    }
+    fflush(stdout);
+
+    server.stop();
+    loop.join();
+    return ok ? 0 : 1;
+}
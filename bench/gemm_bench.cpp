@@ -0,0 +1,94 @@
+#include "service.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+/*
+    矩阵乘法吞吐测试
+    用法: gemm_bench [最大边长，默认1024]
+    对64~最大边长的方阵，分别用1个线程到全部核心执行float/double/int32的gemm，输出GFLOP/s；
+    开始前先用朴素三重循环校验一个非对齐尺寸的结果
+*/
+
+using Clock = std::chrono::steady_clock;
+
+template <typename T>
+static std::vector<T> randomMatrix(size_t count, std::mt19937& rng) {
+    std::vector<T> values(count);
+    for (auto& v : values) v = static_cast<T>(static_cast<int>(rng() % 17) - 8);
+    return values;
+}
+
+// 与朴素实现对比，元素取小整数，float/double的结果也是精确的
+template <typename T>
+static bool verify(size_t m, size_t n, size_t k, trpc::ThreadPool* pool) {
+    std::mt19937 rng(7);
+    auto a = randomMatrix<T>(m * k, rng), b = randomMatrix<T>(k * n, rng);
+    std::vector<T> c(m * n);
+    trpc::simd::gemm(m, n, k, a.data(), b.data(), c.data(), pool);
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            T expect = 0;
+            for (size_t p = 0; p < k; ++p) expect += a[i * k + p] * b[p * n + j];
+            if (c[i * n + j] != expect) return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+static void run(const char* type, size_t max_size, const std::vector<size_t>& thread_counts) {
+    std::mt19937 rng(42);
+    for (size_t n = 64; n <= max_size; n *= 2) {
+        auto a = randomMatrix<T>(n * n, rng), b = randomMatrix<T>(n * n, rng);
+        std::vector<T> c(n * n);
+        for (size_t threads : thread_counts) {
+            // 调用线程也参与计算，线程池只需要threads-1个线程
+            std::unique_ptr<trpc::ThreadPool> pool;
+            if (threads > 1) pool = std::make_unique<trpc::ThreadPool>(static_cast<int>(threads - 1));
+
+            trpc::simd::gemm(n, n, n, a.data(), b.data(), c.data(), pool.get());
+            size_t iterations = 0;
+            auto begin = Clock::now();
+            double elapsed = 0;
+            do {
+                trpc::simd::gemm(n, n, n, a.data(), b.data(), c.data(), pool.get());
+                ++iterations;
+                elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+            } while (elapsed < 0.3);
+
+            double seconds = elapsed / iterations;
+            printf("%8s %8zu %8zu %14.2f %10.2f\n", type, n, threads, seconds * 1e3,
+                   2.0 * n * n * n / seconds / 1e9);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1024;
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<size_t> thread_counts;
+    for (size_t t = 1; t < cores; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(cores);
+
+    std::unique_ptr<trpc::ThreadPool> pool;
+    if (cores > 1) pool = std::make_unique<trpc::ThreadPool>(static_cast<int>(cores - 1));
+    if (!verify<float>(131, 77, 300, pool.get()) || !verify<double>(131, 77, 300, pool.get())
+        || !verify<int32_t>(131, 77, 300, pool.get())) {
+        fprintf(stderr, "gemm result mismatch\n");
+        return 1;
+    }
+
+    printf("isa=%s cores=%zu\n", trpc::simd::isaName(trpc::simd::activeIsa()), cores);
+    printf("%8s %8s %8s %14s %10s\n", "type", "size", "threads", "ms/call", "GFLOP/s");
+    run<float>("float", max_size, thread_counts);
+    run<double>("double", max_size, thread_counts);
+    run<int32_t>("int32", max_size, thread_counts);
+    return 0;
+}
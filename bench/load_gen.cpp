@@ -0,0 +1,265 @@
+#include "client.hpp"
+#include "histogram.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+/*
+    RPC压测客户端，需要先启动server
+    用法: load_gen [--选项=值 ...]
+      --host=127.0.0.1 --port=8080   host为unix://路径时经Unix域socket连接，忽略port
+      --connections=4        RPCClient实例数，每个实例有自己的发送线程
+      --concurrency=16       闭环模式下同时在途的调用数，平均分到各连接
+      --rate=0               大于0时为开环模式：按泊松过程以该速率(次/秒)发起调用，不等上一个调用返回
+      --warmup=1 --duration=5  预热和测量时长(秒)，预热期间发起的调用不计入结果
+      --service=compute --method=add --args=[5,3]
+      --batch=1              是否开启客户端自动合并
+      --format=text          text或json
+    开环模式下延迟从计划发起时刻算起，发送端落后于计划时这段等待也计入延迟，避免协调遗漏(coordinated omission)
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    size_t connections = 4;
+    size_t concurrency = 16;
+    double rate = 0;
+    double warmup = 1;
+    double duration = 5;
+    std::string service = "compute";
+    std::string method = "add";
+    std::vector<nlohmann::json> args = {5, 3};
+    bool batch = true;
+    std::string format = "text";
+};
+
+// 一个连接或一个闭环线程的统计，结束后汇总，测量过程中不共享
+struct LoadStats {
+    trpc::LatencyHistogram latency;
+    uint64_t errors = 0;
+    Clock::time_point last_completion;  // 最后一个计入结果的调用完成的时刻
+};
+
+struct Phase {
+    Clock::time_point measure_begin;
+    Clock::time_point end;
+
+    bool measured(Clock::time_point start) const { return start >= measure_begin && start < end; }
+};
+
+static void usage() {
+    fprintf(stderr, "usage: load_gen [--host=] [--port=] [--connections=] [--concurrency=] [--rate=] "
+                    "[--warmup=] [--duration=] [--service=] [--method=] [--args=] [--batch=] [--format=text|json]\n");
+    exit(2);
+}
+
+static LoadOptions parseOptions(int argc, char* argv[]) {
+    std::map<std::string, std::string> values;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) usage();
+        values[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+    }
+
+    LoadOptions options;
+    for (const auto& kv : values) {
+        const std::string& key = kv.first;
+        const std::string& value = kv.second;
+        if (key == "host") options.host = value;
+        else if (key == "port") options.port = std::atoi(value.c_str());
+        else if (key == "connections") options.connections = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "concurrency") options.concurrency = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "rate") options.rate = std::atof(value.c_str());
+        else if (key == "warmup") options.warmup = std::atof(value.c_str());
+        else if (key == "duration") options.duration = std::atof(value.c_str());
+        else if (key == "service") options.service = value;
+        else if (key == "method") options.method = value;
+        else if (key == "args") options.args = nlohmann::json::parse(value).get<std::vector<nlohmann::json>>();
+        else if (key == "batch") options.batch = value != "0";
+        else if (key == "format") options.format = value;
+        else usage();
+    }
+    if (options.connections == 0 || options.concurrency == 0 || options.duration <= 0
+        || (options.format != "text" && options.format != "json")) {
+        usage();
+    }
+    return options;
+}
+
+static Clock::duration seconds(double s) {
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s));
+}
+
+static void recordCall(LoadStats& stats, Clock::time_point start, bool ok) {
+    auto now = Clock::now();
+    stats.last_completion = std::max(stats.last_completion, now);
+    if (ok) stats.latency.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count()));
+    else ++stats.errors;
+}
+
+// 闭环：每个线程发起一个调用，等它返回后立刻发起下一个
+static void closedLoop(const LoadOptions& options, std::vector<std::unique_ptr<RPCClient>>& clients,
+                       const Phase& phase, std::vector<LoadStats>& stats) {
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < options.concurrency; ++i) {
+        workers.emplace_back([&, i] {
+            RPCClient& client = *clients[i % clients.size()];
+            LoadStats& local = stats[i];
+            for (;;) {
+                auto start = Clock::now();
+                if (start >= phase.end) break;
+                bool ok = true;
+                try {
+                    client.callAsync<nlohmann::json>(options.service, options.method, options.args).get();
+                } catch (const std::exception&) {
+                    ok = false;
+                }
+                if (phase.measured(start)) recordCall(local, start, ok);
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+}
+
+// 开环：每个连接一个发送线程按计划时刻发起调用，一个收集线程按顺序等待结果；
+// 同一连接上的调用按发起顺序完成，顺序等待不会推迟记录
+static void openLoop(const LoadOptions& options, std::vector<std::unique_ptr<RPCClient>>& clients,
+                     const Phase& phase, Clock::time_point begin, std::vector<LoadStats>& stats) {
+    struct Pending {
+        Clock::time_point intended;
+        std::future<nlohmann::json> result;
+    };
+    struct Channel {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Pending> queue;
+        bool done = false;
+    };
+
+    double rate_per_connection = options.rate / clients.size();
+    std::vector<Channel> channels(clients.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        threads.emplace_back([&, i] {
+            std::mt19937_64 rng(0x9e3779b97f4a7c15ull + i);
+            std::exponential_distribution<double> interval(rate_per_connection);
+            Channel& channel = channels[i];
+            for (auto next = begin + seconds(interval(rng)); next < phase.end; next += seconds(interval(rng))) {
+                std::this_thread::sleep_until(next);
+                auto result = clients[i]->callAsync<nlohmann::json>(options.service, options.method, options.args);
+                std::lock_guard<std::mutex> lock(channel.mutex);
+                channel.queue.push_back(Pending{next, std::move(result)});
+                channel.cv.notify_one();
+            }
+            std::lock_guard<std::mutex> lock(channel.mutex);
+            channel.done = true;
+            channel.cv.notify_one();
+        });
+        threads.emplace_back([&, i] {
+            Channel& channel = channels[i];
+            LoadStats& local = stats[i];
+            for (;;) {
+                Pending pending;
+                {
+                    std::unique_lock<std::mutex> lock(channel.mutex);
+                    channel.cv.wait(lock, [&] { return !channel.queue.empty() || channel.done; });
+                    if (channel.queue.empty()) break;
+                    pending = std::move(channel.queue.front());
+                    channel.queue.pop_front();
+                }
+                bool ok = true;
+                try {
+                    pending.result.get();
+                } catch (const std::exception&) {
+                    ok = false;
+                }
+                if (phase.measured(pending.intended)) recordCall(local, pending.intended, ok);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options = parseOptions(argc, argv);
+    bool open_loop = options.rate > 0;
+
+    ClientOptions client_options;
+    client_options.auto_batch = options.batch;
+    std::vector<std::unique_ptr<RPCClient>> clients;
+    for (size_t i = 0; i < options.connections; ++i) {
+        clients.push_back(std::make_unique<RPCClient>(options.host, options.port, client_options));
+    }
+
+    // 先单独调用一次，服务不可用时直接报错退出
+    try {
+        clients[0]->callAsync<nlohmann::json>(options.service, options.method, options.args).get();
+    } catch (const std::exception& e) {
+        fprintf(stderr, "probe call failed: %s\n", e.what());
+        return 1;
+    }
+
+    auto begin = Clock::now();
+    Phase phase{begin + seconds(options.warmup), begin + seconds(options.warmup + options.duration)};
+    std::vector<LoadStats> stats(open_loop ? clients.size() : options.concurrency);
+    if (open_loop) openLoop(options, clients, phase, begin, stats);
+    else closedLoop(options, clients, phase, stats);
+
+    LoadStats total;
+    for (const auto& s : stats) {
+        total.latency.merge(s.latency);
+        total.errors += s.errors;
+        total.last_completion = std::max(total.last_completion, s.last_completion);
+    }
+    // 吞吐按实际完成计算：开环模式过载时调用在测量期结束后才陆续完成，完成速率低于发起速率
+    const auto& h = total.latency;
+    double elapsed = std::max(options.duration,
+                              std::chrono::duration<double>(total.last_completion - phase.measure_begin).count());
+    double throughput = h.count() / elapsed;
+    auto us = [](uint64_t ns) { return ns / 1e3; };
+
+    if (options.format == "json") {
+        nlohmann::json report;
+        report["mode"] = open_loop ? "open" : "closed";
+        report["service"] = options.service;
+        report["method"] = options.method;
+        report["connections"] = options.connections;
+        if (open_loop) report["rate"] = options.rate;
+        else report["concurrency"] = options.concurrency;
+        report["warmup_s"] = options.warmup;
+        report["duration_s"] = options.duration;
+        report["requests"] = h.count();
+        report["errors"] = total.errors;
+        report["throughput"] = throughput;
+        report["latency_us"] = {
+            {"min", us(h.min())}, {"mean", h.mean() / 1e3},
+            {"p50", us(h.valueAtPercentile(50))}, {"p90", us(h.valueAtPercentile(90))},
+            {"p99", us(h.valueAtPercentile(99))}, {"p999", us(h.valueAtPercentile(99.9))},
+            {"max", us(h.max())}
+        };
+        printf("%s\n", report.dump(2).c_str());
+        return 0;
+    }
+
+    printf("mode=%s %s.%s connections=%zu ", open_loop ? "open" : "closed",
+           options.service.c_str(), options.method.c_str(), options.connections);
+    if (open_loop) printf("rate=%.0f/s ", options.rate);
+    else printf("concurrency=%zu ", options.concurrency);
+    printf("warmup=%.1fs duration=%.1fs\n", options.warmup, options.duration);
+    printf("requests=%llu errors=%llu throughput=%.1f req/s\n",
+           static_cast<unsigned long long>(h.count()), static_cast<unsigned long long>(total.errors), throughput);
+    printf("%10s %10s %10s %10s %10s %10s %10s\n", "latency", "min", "mean", "p50", "p99", "p999", "max");
+    printf("%10s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", "(us)", us(h.min()), h.mean() / 1e3,
+           us(h.valueAtPercentile(50)), us(h.valueAtPercentile(99)), us(h.valueAtPercentile(99.9)), us(h.max()));
+    return 0;
+}
@@ -0,0 +1,360 @@
+#include "server.hpp"
+#include "client.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+    核心组件的微基准测试，每项单独测量热点路径的单次开销
+    用法: micro_bench [名称过滤，子串匹配]
+    每项自动调整迭代次数，使总耗时不少于0.2秒，输出每次操作的纳秒数和每秒操作数
+      ThreadPool/addTask/P    P个生产者同时提交空任务，直到全部执行完
+      Reactor/post            跨线程投递任务到事件循环
+      Reactor/fd_dispatch     写eventfd到事件循环回调的一次往返
+      JSON/...                请求信封解析、请求和响应序列化
+      Registry/getService     服务查找(命中/未命中)
+      Compute/...             标量方法分发；除零错误以Status返回和以异常抛出的开销
+      MessageQueue/...        客户端消息队列，同线程和跨线程
+      CacheKey/build          在arena中拼接缓存键
+      SlabPool/...            对象池复用与new/delete的对比
+      Frame/...               响应帧编码：拼接到std::string与追加到IOBuf(小响应拷贝，缓存命中共享)
+      Logger/...              异步日志的记录开销，输出到/dev/null
+*/
+
+using Clock = std::chrono::steady_clock;
+
+// 阻止编译器把结果未被使用的计算优化掉
+template <typename T>
+static inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class Runner {
+    public:
+        explicit Runner(const char* filter) : filter_(filter ? filter : "") {
+            printf("%-36s %12s %14s %14s\n", "benchmark", "ns/op", "iterations", "ops/s");
+        }
+
+        bool enabled(const std::string& prefix) const {
+            return filter_.empty() || prefix.find(filter_) != std::string::npos
+                || filter_.find(prefix) != std::string::npos;
+        }
+
+        // fn(iterations)执行iterations次被测操作；从1次开始按耗时估算放大，直到单轮耗时足够长
+        void run(const std::string& name, const std::function<void(size_t)>& fn) {
+            if (!filter_.empty() && name.find(filter_) == std::string::npos) return;
+            size_t iterations = 1;
+            double elapsed = 0;
+            for (;;) {
+                auto begin = Clock::now();
+                fn(iterations);
+                elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+                if (elapsed >= kMinTime || iterations >= kMaxIterations) break;
+                double scale = elapsed < kMinTime / 100 ? 100 : kMinTime * 1.4 / elapsed;
+                iterations = std::min(kMaxIterations, static_cast<size_t>(iterations * scale) + 1);
+            }
+            printf("%-36s %12.1f %14zu %14.0f\n", name.c_str(), elapsed * 1e9 / iterations, iterations,
+                   iterations / elapsed);
+            fflush(stdout);
+        }
+
+    private:
+        static constexpr double kMinTime = 0.2;
+        static constexpr size_t kMaxIterations = size_t(1) << 30;
+        std::string filter_;
+};
+
+static void benchThreadPool(Runner& runner) {
+    if (!runner.enabled("ThreadPool/")) return;
+    int workers = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+    trpc::ThreadPool pool(workers);
+    for (size_t producers = 1; producers <= 64; producers *= 2) {
+        runner.run("ThreadPool/addTask/" + std::to_string(producers), [&](size_t iterations) {
+            std::atomic<size_t> done{0};
+            std::vector<std::thread> threads;
+            for (size_t p = 0; p < producers; ++p) {
+                size_t count = iterations / producers + (p < iterations % producers ? 1 : 0);
+                threads.emplace_back([&, count] {
+                    for (size_t i = 0; i < count; ++i) {
+                        pool.addTask([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+                    }
+                });
+            }
+            for (auto& thread : threads) thread.join();
+            while (done.load(std::memory_order_acquire) != iterations) std::this_thread::yield();
+        });
+    }
+}
+
+static void benchReactor(Runner& runner) {
+    if (!runner.enabled("Reactor/")) return;
+    trpc::Reactor reactor;
+    int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    reactor.addFd(event_fd, EPOLLIN);
+    std::atomic<size_t> dispatched{0};
+    std::thread loop([&] {
+        reactor.run([&](int fd) {
+            uint64_t value;
+            while (read(fd, &value, sizeof(value)) > 0) {}
+            dispatched.fetch_add(1, std::memory_order_release);
+        });
+    });
+
+    runner.run("Reactor/post", [&](size_t iterations) {
+        std::atomic<size_t> done{0};
+        for (size_t i = 0; i < iterations; ++i) {
+            reactor.post([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+        while (done.load(std::memory_order_acquire) != iterations) std::this_thread::yield();
+    });
+
+    runner.run("Reactor/fd_dispatch", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            size_t expect = dispatched.load(std::memory_order_acquire) + 1;
+            uint64_t one = 1;
+            ssize_t n = write(event_fd, &one, sizeof(one));
+            (void)n;
+            while (dispatched.load(std::memory_order_acquire) != expect) {}
+        }
+    });
+
+    reactor.stop();
+    loop.join();
+    close(event_fd);
+}
+
+static const std::string kEnvelope = R"({"service_name":"compute","method_name":"add","args":[5,3]})";
+
+static void benchJson(Runner& runner) {
+    runner.run("JSON/parse_envelope", [](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            auto request = nlohmann::json::parse(kEnvelope);
+            doNotOptimize(request);
+        }
+    });
+
+    auto request = nlohmann::json::parse(kEnvelope);
+    runner.run("JSON/dump_envelope", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            std::string text = request.dump();
+            doNotOptimize(text);
+        }
+    });
+
+    runner.run("JSON/dump_response", [](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            nlohmann::json response;
+            response["result"] = 8;
+            std::string text = response.dump();
+            doNotOptimize(text);
+        }
+    });
+}
+
+static void benchRegistry(Runner& runner) {
+    if (!runner.enabled("Registry/")) return;
+    trpc::LocalServiceRegistry registry;
+    for (int i = 0; i < 15; ++i) {
+        registry.registerService("service_" + std::to_string(i), std::make_unique<trpc::ComputeService<int>>());
+    }
+    registry.registerService("compute", std::make_unique<trpc::ComputeService<int>>());
+    const std::string hit = "compute", miss = "missing";
+
+    runner.run("Registry/getService/hit", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) doNotOptimize(registry.getService(hit));
+    });
+    runner.run("Registry/getService/miss", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) doNotOptimize(registry.getService(miss));
+    });
+}
+
+static void benchCompute(Runner& runner) {
+    trpc::ComputeService<int> service;
+    const std::vector<int> args = {6, 3};
+    const std::string add = "add", div = "div";
+
+    // add是第一个分支，div是最后一个，两者之差即按名字分发的开销
+    runner.run("Compute/execute/add", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) doNotOptimize(service.execute(add, args));
+    });
+    runner.run("Compute/execute/div", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) doNotOptimize(service.execute(div, args));
+    });
+
+    // 同一个除零错误，以Status返回与以异常抛出的开销对比
+    const std::vector<int> zero = {6, 0};
+    runner.run("Compute/call/div_zero", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) doNotOptimize(service.call(div, zero).ok());
+    });
+    runner.run("Compute/execute/div_zero", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            try {
+                doNotOptimize(service.execute(div, zero));
+            } catch (const std::domain_error&) {}
+        }
+    });
+}
+
+static MessageQueue::Message makeMessage() {
+    MessageQueue::Message msg;
+    msg.service_name = "compute";
+    msg.method_name = "add";
+    msg.request_data = kEnvelope;
+    msg.batchable = true;
+    return msg;
+}
+
+static void benchMessageQueue(Runner& runner) {
+    runner.run("MessageQueue/push_pop", [](size_t iterations) {
+        MessageQueue queue;
+        MessageQueue::Message out;
+        for (size_t i = 0; i < iterations; ++i) {
+            queue.push(makeMessage());
+            queue.pop(out);
+        }
+    });
+
+    runner.run("MessageQueue/cross_thread", [](size_t iterations) {
+        MessageQueue queue;
+        std::thread producer([&] {
+            for (size_t i = 0; i < iterations; ++i) queue.push(makeMessage());
+            queue.close();
+        });
+        MessageQueue::Message out;
+        size_t received = 0;
+        while (queue.pop(out)) ++received;
+        producer.join();
+        doNotOptimize(received);
+    });
+}
+
+static void benchCacheKey(Runner& runner) {
+    const std::string service = "compute", method = "add";
+    trpc::Arena arena;
+    runner.run("CacheKey/build", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            std::string_view key = trpc::makeCacheKey(arena, service, method, kEnvelope);
+            doNotOptimize(key);
+            arena.reset();
+        }
+    });
+}
+
+// 池中对象复用时保留字符串的容量，与每次new/delete对比
+struct PooledBuffer {
+    std::string data;
+
+    void reset() { data.clear(); }
+};
+
+static void benchPool(Runner& runner) {
+    runner.run("SlabPool/acquire_release", [](size_t iterations) {
+        trpc::SlabPool<PooledBuffer> pool;
+        for (size_t i = 0; i < iterations; ++i) {
+            PooledBuffer* buffer = pool.acquire();
+            buffer->data.assign(kEnvelope);
+            doNotOptimize(buffer->data);
+            pool.release(buffer);
+        }
+    });
+    runner.run("SlabPool/new_delete", [](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            PooledBuffer* buffer = new PooledBuffer();
+            buffer->data.assign(kEnvelope);
+            doNotOptimize(buffer->data);
+            delete buffer;
+        }
+    });
+}
+
+static void benchFrame(Runner& runner) {
+    const std::string small = R"({"result":8})";
+    runner.run("Frame/string/small", [&](size_t iterations) {
+        std::string frame;
+        for (size_t i = 0; i < iterations; ++i) {
+            trpc::encodeFrameTo(frame, small, std::string());
+            doNotOptimize(frame);
+        }
+    });
+    runner.run("Frame/iobuf/small", [&](size_t iterations) {
+        trpc::IOBuf frame;
+        for (size_t i = 0; i < iterations; ++i) {
+            std::string meta = small;
+            trpc::encodeFrameTo(frame, std::move(meta), std::string());
+            doNotOptimize(frame);
+            frame.clear();
+        }
+    });
+
+    // 缓存命中时的16KB响应：拷贝进帧与共享缓存值的块
+    const std::string value(16 * 1024, '7');
+    trpc::IOBuf cached;
+    cached.appendExternal(value.data(), value.size(), nullptr, nullptr);
+    runner.run("Frame/cached_copy/16K", [&](size_t iterations) {
+        std::string frame;
+        for (size_t i = 0; i < iterations; ++i) {
+            trpc::encodeFrameTo(frame, value, std::string());
+            doNotOptimize(frame);
+        }
+    });
+    runner.run("Frame/cached_share/16K", [&](size_t iterations) {
+        trpc::IOBuf frame;
+        for (size_t i = 0; i < iterations; ++i) {
+            trpc::appendFrameHeader(frame, cached.size(), 0);
+            frame.append(cached);
+            trpc::appendFramePadding(frame, cached.size());
+            doNotOptimize(frame);
+            frame.clear();
+        }
+    });
+}
+
+static void benchLogger(Runner& runner) {
+    if (!runner.enabled("Logger/")) return;
+    int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    trpc::Logger::instance().setOutputFd(null_fd);
+    trpc::Logger::instance().setRateLimit(0);
+    const std::string what = "Division by zero";
+    runner.run("Logger/log", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            TRPC_LOG(trpc::LogLevel::Warn, "Error processing message: {} ({})", what, i);
+        }
+    });
+    // 被限速抑制的调用只做计数
+    trpc::Logger::instance().setRateLimit(100);
+    runner.run("Logger/log_suppressed", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            TRPC_LOG(trpc::LogLevel::Warn, "Error processing message: {} ({})", what, i);
+        }
+    });
+    trpc::Logger::instance().setMinLevel(trpc::LogLevel::Error);
+    runner.run("Logger/log_filtered", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            TRPC_LOG(trpc::LogLevel::Warn, "Error processing message: {} ({})", what, i);
+        }
+    });
+    trpc::Logger::instance().flush();
+    trpc::LoggerStats stats = trpc::Logger::instance().stats();
+    printf("logger: written=%llu dropped=%llu suppressed=%llu\n", static_cast<unsigned long long>(stats.written),
+           static_cast<unsigned long long>(stats.dropped), static_cast<unsigned long long>(stats.suppressed));
+}
+
+int main(int argc, char* argv[]) {
+    Runner runner(argc > 1 ? argv[1] : nullptr);
+    benchThreadPool(runner);
+    benchReactor(runner);
+    benchJson(runner);
+    benchRegistry(runner);
+    benchCompute(runner);
+    benchMessageQueue(runner);
+    benchCacheKey(runner);
+    benchPool(runner);
+    benchFrame(runner);
+    benchLogger(runner);
+    return 0;
+}
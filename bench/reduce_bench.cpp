@@ -0,0 +1,84 @@
+#include "service.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+/*
+    归约方法的扩展性测试
+    用法: reduce_bench [最大元素数，默认1亿]
+    对1K~最大元素数的int32数组，分别用1个线程到全部核心执行sum/min/max/dot/histogram
+*/
+
+using Clock = std::chrono::steady_clock;
+
+// 重复执行fn直到累计超过一定时间，返回单次耗时(秒)
+template <typename Fn>
+static double measure(Fn fn) {
+    volatile int64_t sink = 0;
+    sink = sink + fn();
+    size_t iterations = 0;
+    auto begin = Clock::now();
+    double elapsed = 0;
+    do {
+        sink = sink + fn();
+        ++iterations;
+        elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    } while (elapsed < 0.2);
+    return elapsed / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000000;
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<size_t> thread_counts;
+    for (size_t t = 1; t < cores; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(cores);
+
+    std::mt19937 rng(42);
+    std::vector<int> a(max_size), b(max_size);
+    for (size_t i = 0; i < max_size; ++i) {
+        a[i] = static_cast<int>(rng() % 20001) - 10000;
+        b[i] = static_cast<int>(rng() % 201) - 100;
+    }
+
+    printf("isa=%s cores=%zu\n", trpc::simd::isaName(trpc::simd::activeIsa()), cores);
+    printf("%12s %8s %10s %14s %10s\n", "elements", "threads", "op", "us/call", "GB/s");
+    for (size_t n = 1000; n <= max_size; n *= 10) {
+        std::vector<int> x(a.begin(), a.begin() + n), y(b.begin(), b.begin() + n);
+        for (size_t threads : thread_counts) {
+            // 调用线程也参与计算，线程池只需要threads-1个线程
+            std::unique_ptr<trpc::ThreadPool> pool;
+            trpc::ComputeService<int> service;
+            if (threads > 1) {
+                pool = std::make_unique<trpc::ThreadPool>(static_cast<int>(threads - 1));
+                service.setThreadPool(pool.get());
+            }
+
+            struct Case {
+                const char* name;
+                size_t bytes;
+                std::function<int64_t()> run;
+            } cases[] = {
+                {"sum", n * sizeof(int), [&] { return service.reduce("sum", x); }},
+                {"min", n * sizeof(int), [&] { return service.reduce("min", x); }},
+                {"max", n * sizeof(int), [&] { return service.reduce("max", x); }},
+                {"dot", 2 * n * sizeof(int), [&] { return service.dot(x, y); }},
+                {"histogram", n * sizeof(int), [&] {
+                    return static_cast<int64_t>(service.histogram(x, 64, -10000, 10001)[0]);
+                }},
+            };
+            for (auto& c : cases) {
+                double seconds = measure(c.run);
+                printf("%12zu %8zu %10s %14.2f %10.2f\n", n, threads, c.name,
+                       seconds * 1e6, c.bytes / seconds / 1e9);
+            }
+        }
+    }
+    return 0;
+}
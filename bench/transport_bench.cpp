@@ -0,0 +1,188 @@
+#include "client.hpp"
+#include "histogram.hpp"
+#include <netinet/tcp.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+    TCP回环与Unix域socket的延迟对比，需要先启动server(example/server.cpp同时监听两者)
+    用法: transport_bench [--host=127.0.0.1] [--port=8080] [--unix=/tmp/trpc.sock] [--iterations=20000]
+    每项在两种传输上各串行执行iterations次，输出延迟的p50/p99/mean和Unix域socket相对TCP的p50加速比
+      rpc/add             RPCClient调用，客户端每次调用新建连接，包含连接建立和关闭
+      persistent/add      在一个长连接上反复发送同一个请求帧，只有帧的往返
+      persistent/scale64K 长连接上发送64KB二进制参数(text.scale)，返回64KB
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::string unix_path = "/tmp/trpc.sock";
+    size_t iterations = 20000;
+};
+
+static BenchOptions parseOptions(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = eq == std::string::npos ? arg : arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+        if (key == "--host") options.host = value;
+        else if (key == "--port") options.port = std::atoi(value.c_str());
+        else if (key == "--unix") options.unix_path = value;
+        else if (key == "--iterations") options.iterations = std::strtoull(value.c_str(), nullptr, 10);
+        else {
+            fprintf(stderr, "usage: transport_bench [--host=] [--port=] [--unix=] [--iterations=]\n");
+            exit(2);
+        }
+    }
+    return options;
+}
+
+static int connectTcp(const BenchOptions& options) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options.port);
+    addr.sin_addr.s_addr = inet_addr(options.host.c_str());
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static int connectUnix(const BenchOptions& options) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (options.unix_path.size() >= sizeof(addr.sun_path)) {
+        close(fd);
+        return -1;
+    }
+    memcpy(addr.sun_path, options.unix_path.data(), options.unix_path.size());
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool sendAll(int fd, const std::string& data) {
+    for (size_t sent = 0; sent < data.size();) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool recvAll(int fd, char* out, size_t size) {
+    for (size_t received = 0; received < size;) {
+        ssize_t n = recv(fd, out + received, size - received, 0);
+        if (n <= 0) return false;
+        received += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 发送一帧并读完响应帧；响应为错误时返回false
+static bool roundTrip(int fd, const std::string& frame, std::string& response) {
+    char header[trpc::kFrameHeaderSize];
+    size_t meta_size, payload_size;
+    if (!sendAll(fd, frame) || !recvAll(fd, header, sizeof(header))) return false;
+    trpc::decodeFrameHeader(header, meta_size, payload_size);
+    response.resize(trpc::framePayloadOffset(meta_size) - trpc::kFrameHeaderSize + payload_size);
+    if (!recvAll(fd, &response[0], response.size())) return false;
+    return response.compare(0, 9, "{\"error\":") != 0;
+}
+
+struct Sample {
+    trpc::LatencyHistogram latency;
+    bool ok = true;
+};
+
+static Sample persistent(int fd, const std::string& frame, size_t iterations) {
+    Sample sample;
+    std::string response;
+    if (fd == -1) {
+        sample.ok = false;
+        return sample;
+    }
+    // 预热：建立连接后的前几次往返要分配缓冲区
+    for (size_t i = 0; i < 100 && sample.ok; ++i) sample.ok = roundTrip(fd, frame, response);
+    for (size_t i = 0; i < iterations && sample.ok; ++i) {
+        auto begin = Clock::now();
+        sample.ok = roundTrip(fd, frame, response);
+        sample.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+    }
+    close(fd);
+    return sample;
+}
+
+static Sample rpcCalls(const std::string& address, int port, size_t iterations) {
+    Sample sample;
+    ClientOptions client_options;
+    client_options.auto_batch = false;
+    RPCClient client(address, port, client_options);
+    const std::vector<int> args = {5, 3};
+    try {
+        for (size_t i = 0; i < 100; ++i) client.callAsync<int>("compute", "add", args).get();
+        for (size_t i = 0; i < iterations; ++i) {
+            auto begin = Clock::now();
+            client.callAsync<int>("compute", "add", args).get();
+            sample.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s: %s\n", address.c_str(), e.what());
+        sample.ok = false;
+    }
+    return sample;
+}
+
+static void report(const char* name, const Sample& tcp, const Sample& unix_socket) {
+    auto us = [](uint64_t ns) { return ns / 1e3; };
+    auto line = [&](const char* transport, const Sample& s) {
+        if (!s.ok) {
+            printf("%-22s %-6s %10s\n", name, transport, "failed");
+            return;
+        }
+        const auto& h = s.latency;
+        printf("%-22s %-6s %10.1f %10.1f %10.1f\n", name, transport, us(h.valueAtPercentile(50)),
+               us(h.valueAtPercentile(99)), h.mean() / 1e3);
+    };
+    line("tcp", tcp);
+    line("unix", unix_socket);
+    if (tcp.ok && unix_socket.ok) {
+        printf("%-22s %-6s %9.2fx\n", name, "p50", static_cast<double>(tcp.latency.valueAtPercentile(50))
+                                                     / unix_socket.latency.valueAtPercentile(50));
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options = parseOptions(argc, argv);
+    printf("%-22s %-6s %10s %10s %10s\n", "benchmark", "", "p50 us", "p99 us", "mean us");
+
+    report("rpc/add", rpcCalls(options.host, options.port, options.iterations),
+           rpcCalls("unix://" + options.unix_path, 0, options.iterations));
+
+    std::string add = trpc::encodeFrame(R"({"service_name":"compute","method_name":"add","args":[5,3]})");
+    report("persistent/add", persistent(connectTcp(options), add, options.iterations),
+           persistent(connectUnix(options), add, options.iterations));
+
+    std::vector<double> values(8192, 1.5);
+    std::string scale = trpc::encodeFrame(R"({"service_name":"text","method_name":"scale"})",
+                                          trpc::encodeValues(values, 2.0));
+    report("persistent/scale64K", persistent(connectTcp(options), scale, options.iterations),
+           persistent(connectUnix(options), scale, options.iterations));
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include <arpa/inet.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+    MSG_ZEROCOPY与普通send的对比，用于确定ServerOptions::zerocopy_threshold
+    用法: zerocopy_bench [每种尺寸发送的总字节数，单位MB，默认512]
+    在一对TCP连接上由一个线程持续发送、另一个线程接收丢弃，消息大小从4KB到16MB；
+    输出两种方式的吞吐、发送线程每KB消耗的CPU时间，以及零拷贝完成通知中被内核退回拷贝的比例。
+    走回环时内核在接收端仍要拷贝一次(通知带SO_EE_CODE_ZEROCOPY_COPIED)，
+    真实网卡上的收益需要在跨机器的环境中用同样的方法测量
+*/
+
+static double threadCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double wallSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 建立一对回环TCP连接，返回发送端和接收端
+static void connectPair(int& sender, int& receiver) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(listener, 1) == -1
+        || getsockname(listener, (struct sockaddr*)&addr, &len) == -1) {
+        perror("listen");
+        exit(1);
+    }
+    sender = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(sender, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        perror("connect");
+        exit(1);
+    }
+    receiver = accept(listener, nullptr, nullptr);
+    close(listener);
+}
+
+struct ZeroCopyReaper {
+    uint32_t sent = 0;          // 零拷贝发送的次数，也是下一次发送的序号
+    uint32_t completed = 0;     // 已收到完成通知的次数
+    uint32_t copied = 0;        // 其中内核退回拷贝的次数
+
+    // 读取错误队列中的完成通知；wait为true时等到全部发送都完成
+    void reap(int fd, bool wait) {
+        while (completed < sent) {
+            char control[128];
+            struct msghdr msg = {};
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+                if (!wait) return;
+                struct pollfd pfd = {fd, 0, 0};
+                poll(&pfd, 1, 100);
+                continue;
+            }
+            for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+                auto* err = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+                if (err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+                uint32_t count = err->ee_data - err->ee_info + 1;
+                completed += count;
+                if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) copied += count;
+            }
+        }
+    }
+};
+
+struct Result {
+    double gbps;
+    double cpu_ns_per_kb;       // 发送线程的CPU时间
+    double copied_ratio;
+};
+
+static Result run(size_t message_size, size_t total_bytes, bool zerocopy) {
+    int sender, receiver;
+    connectPair(sender, receiver);
+    int one = 1;
+    if (zerocopy && setsockopt(sender, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == -1) {
+        perror("SO_ZEROCOPY");
+        exit(1);
+    }
+
+    std::atomic<size_t> received{0};
+    std::thread reader([&] {
+        std::vector<char> buffer(1 << 20);
+        ssize_t n;
+        while ((n = recv(receiver, buffer.data(), buffer.size(), 0)) > 0) {
+            received.fetch_add(static_cast<size_t>(n), std::memory_order_relaxed);
+        }
+    });
+
+    // 每条消息用独立的缓冲区轮流发送，零拷贝时发送后不再改写，直到收到完成通知
+    std::vector<std::string> messages(4, std::string(message_size, 'x'));
+    size_t count = std::max<size_t>(1, total_bytes / message_size);
+    ZeroCopyReaper reaper;
+    double cpu_begin = threadCpuSeconds(), wall_begin = wallSeconds();
+    for (size_t i = 0; i < count; ++i) {
+        const std::string& message = messages[i % messages.size()];
+        size_t offset = 0;
+        while (offset < message.size()) {
+            struct iovec iov = {const_cast<char*>(message.data()) + offset, message.size() - offset};
+            struct msghdr msg = {};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            ssize_t n = sendmsg(sender, &msg, MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0));
+            if (n == -1) {
+                if (errno == ENOBUFS) {
+                    // 未读取的完成通知超过optmem_max，先收取再重试
+                    reaper.reap(sender, false);
+                    continue;
+                }
+                perror("sendmsg");
+                exit(1);
+            }
+            if (zerocopy) ++reaper.sent;
+            offset += static_cast<size_t>(n);
+        }
+        if (zerocopy) reaper.reap(sender, false);
+    }
+    if (zerocopy) reaper.reap(sender, true);
+    double cpu = threadCpuSeconds() - cpu_begin;
+    shutdown(sender, SHUT_WR);
+    reader.join();
+    double wall = wallSeconds() - wall_begin;
+    close(sender);
+    close(receiver);
+
+    double bytes = static_cast<double>(received.load());
+    return Result{bytes / wall / 1e9, cpu * 1e9 / (bytes / 1024),
+                  reaper.sent ? static_cast<double>(reaper.copied) / reaper.sent : 0};
+}
+
+int main(int argc, char* argv[]) {
+    size_t total = (argc > 1 ? strtoull(argv[1], nullptr, 10) : 512) << 20;
+    printf("%10s %12s %14s %12s %14s %10s\n", "size", "copy GB/s", "copy cpu/KB", "zc GB/s", "zc cpu/KB", "zc copied");
+    size_t crossover = 0;
+    for (size_t size = 4 << 10; size <= (16 << 20); size *= 4) {
+        Result copy = run(size, total, false);
+        Result zc = run(size, total, true);
+        printf("%8zuKB %12.2f %12.1fns %12.2f %12.1fns %9.0f%%\n", size >> 10, copy.gbps, copy.cpu_ns_per_kb,
+               zc.gbps, zc.cpu_ns_per_kb, zc.copied_ratio * 100);
+        fflush(stdout);
+        if (!crossover && zc.cpu_ns_per_kb < copy.cpu_ns_per_kb) crossover = size;
+    }
+    if (crossover) {
+        printf("crossover: zerocopy costs less sender CPU from %zuKB\n", crossover >> 10);
+    } else {
+        printf("crossover: none on this path, leave zerocopy_threshold at 0\n");
+    }
+    return 0;
+}
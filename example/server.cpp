@@ -1,18 +1,85 @@
 #include "server.hpp"
 #include "service.hpp"
+#include "calc.gen.hpp"
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+
+// 带类型的服务示例：参数类型各不相同，由method()在编译期生成编解码代码
+class TextService : public trpc::TypedService {
+    public:
+        TextService() : TypedService("text") {
+            method("scale", &TextService::scale);
+            method("repeat", &TextService::repeat);
+        }
+
+        // 视图参数直接指向请求缓冲区，不拷贝
+        std::vector<double> scale(trpc::ArrayView<double> values, double factor) {
+            std::vector<double> out(values.size());
+            for (size_t i = 0; i < values.size(); ++i) out[i] = values[i] * factor;
+            return out;
+        }
+
+        std::string repeat(std::string_view text, int32_t times) {
+            std::string out;
+            for (int32_t i = 0; i < times; ++i) out += text;
+            return out;
+        }
+};
+
+// IDL服务示例：实现生成的骨架中的纯虚函数即可
+class GeometryService : public calc::GeometrySkeleton {
+    public:
+        double distance(const calc::Point& a, const calc::Point& b) override {
+            return std::hypot(a.x - b.x, a.y - b.y);
+        }
+
+        calc::Point centroid(const std::vector<calc::Point>& points) override {
+            calc::Point center;
+            for (const auto& p : points) {
+                center.x += p.x;
+                center.y += p.y;
+            }
+            if (!points.empty()) {
+                center.x /= points.size();
+                center.y /= points.size();
+            }
+            return center;
+        }
+
+        calc::Summary summarize(const std::vector<double>& values) override {
+            calc::Summary summary;
+            summary.count = values.size();
+            if (values.empty()) return summary;
+            auto range = std::minmax_element(values.begin(), values.end());
+            summary.min = *range.first;
+            summary.max = *range.second;
+            for (double v : values) summary.mean += v;
+            summary.mean /= values.size();
+            return summary;
+        }
+};
 
 int main() {
     try {
-        // 创建服务器实例
-        trpc::Server server(8080);
+        // 创建服务器实例，9090为管理端口，GET /metrics输出Prometheus格式的指标；
+        // 同一台机器上的客户端可以经/tmp/trpc.sock连接，用"unix:///tmp/trpc.sock"作为地址
+        trpc::ServerOptions options;
+        options.admin_port = 9090;
+        options.unix_path = "/tmp/trpc.sock";
+        trpc::Server server(8080, options);
 
         // 创建并注册计算服务
         auto compute_service = std::make_unique<trpc::ComputeService<int>>();
         server.registerService("compute", std::move(compute_service));
+        // 浮点版本，用于矩阵乘法等浮点计算
+        server.registerService("compute_f32", std::make_unique<trpc::ComputeService<float>>());
+        server.registerService("compute_f64", std::make_unique<trpc::ComputeService<double>>());
+        server.registerService("text", std::make_unique<TextService>());
+        server.registerService("geometry", std::make_unique<GeometryService>());
 
         // 启动服务器
-        std::cout << "Server started on port 8080" << std::endl;
+        std::cout << "Server started on port 8080 and " << options.unix_path << ", metrics on port 9090" << std::endl;
         server.start();
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -0,0 +1,399 @@
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+    IDL代码生成器
+    用法: trpc_idlgen <输入.idl> <输出.hpp>
+
+    IDL格式：
+        package calc;                       // 可选，生成代码所在的命名空间
+        message Point { f64 x; f64 y; }
+        service Geometry {
+            f64 distance(Point a, Point b);
+            list<Point> scale(list<Point> points, f64 factor);
+        }
+    类型：i32 i64 u32 u64 f32 f64 bool string list<T> 以及先前声明的message，返回值还可以是void
+
+    生成内容：
+        +每个message的结构体和trpc::Codec特化(字段按声明顺序定长编码)
+        +<Service>MethodIds ： 生成时按FNV-1a("服务.方法")算好的方法id
+        +<Service>Client ： 客户端存根，按id调用，不需要传方法名
+        +<Service>Skeleton ： 服务端骨架，继承IdlService，按id用switch分发到纯虚函数
+*/
+
+namespace {
+
+struct Token {
+    std::string text;
+    int line;
+};
+
+std::vector<Token> tokenize(const std::string& source) {
+    std::vector<Token> tokens;
+    int line = 1;
+    for (size_t i = 0; i < source.size();) {
+        char c = source[i];
+        if (c == '\n') {
+            ++line;
+            ++i;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (c == '/' && i + 1 < source.size() && source[i + 1] == '/') {
+            while (i < source.size() && source[i] != '\n') ++i;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t begin = i;
+            while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_')) ++i;
+            tokens.push_back({source.substr(begin, i - begin), line});
+        } else if (std::string("{}()<>;,").find(c) != std::string::npos) {
+            tokens.push_back({std::string(1, c), line});
+            ++i;
+        } else {
+            throw std::runtime_error("line " + std::to_string(line) + ": unexpected character '" + c + "'");
+        }
+    }
+    return tokens;
+}
+
+struct Field {
+    std::string type;       // C++类型
+    std::string name;
+    bool scalar;            // 按值传递
+};
+
+struct Message {
+    std::string name;
+    std::vector<Field> fields;
+};
+
+struct Method {
+    std::string name;
+    std::string return_type;
+    std::vector<Field> params;
+    uint32_t id;
+};
+
+struct Service {
+    std::string name;
+    std::vector<Method> methods;
+};
+
+uint32_t fnv1a(const std::string& text) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+class Parser {
+    public:
+        explicit Parser(std::vector<Token> tokens) : tokens_(std::move(tokens)), pos_(0) {}
+
+        void parse() {
+            if (peek("package")) {
+                next();
+                package_ = identifier();
+                expect(";");
+            }
+            while (pos_ < tokens_.size()) {
+                if (peek("message")) {
+                    parseMessage();
+                } else if (peek("service")) {
+                    parseService();
+                } else {
+                    fail("expected 'message' or 'service'");
+                }
+            }
+        }
+
+        const std::string& package() const { return package_; }
+        const std::vector<Message>& messages() const { return messages_; }
+        const std::vector<Service>& services() const { return services_; }
+
+    private:
+        bool peek(const std::string& text) const {
+            return pos_ < tokens_.size() && tokens_[pos_].text == text;
+        }
+
+        const Token& next() {
+            if (pos_ >= tokens_.size()) {
+                throw std::runtime_error("unexpected end of file");
+            }
+            return tokens_[pos_++];
+        }
+
+        [[noreturn]] void fail(const std::string& what) const {
+            int line = pos_ < tokens_.size() ? tokens_[pos_].line : (tokens_.empty() ? 1 : tokens_.back().line);
+            throw std::runtime_error("line " + std::to_string(line) + ": " + what);
+        }
+
+        void expect(const std::string& text) {
+            if (!peek(text)) fail("expected '" + text + "'");
+            ++pos_;
+        }
+
+        std::string identifier() {
+            if (pos_ >= tokens_.size()) fail("expected identifier");
+            const std::string& text = tokens_[pos_].text;
+            if (!std::isalpha(static_cast<unsigned char>(text[0])) && text[0] != '_') fail("expected identifier");
+            ++pos_;
+            return text;
+        }
+
+        // 返回C++类型，scalar表示可以按值传递
+        std::string type(bool& scalar, bool allow_void = false) {
+            static const std::map<std::string, std::string> builtins = {
+                {"i32", "int32_t"}, {"i64", "int64_t"}, {"u32", "uint32_t"}, {"u64", "uint64_t"},
+                {"f32", "float"}, {"f64", "double"}, {"bool", "bool"},
+            };
+            std::string name = identifier();
+            scalar = false;
+            if (name == "void") {
+                if (!allow_void) fail("void is only allowed as a return type");
+                scalar = true;
+                return "void";
+            }
+            auto it = builtins.find(name);
+            if (it != builtins.end()) {
+                scalar = true;
+                return it->second;
+            }
+            if (name == "string") return "std::string";
+            if (name == "list") {
+                expect("<");
+                bool element_scalar;
+                std::string element = type(element_scalar);
+                expect(">");
+                return "std::vector<" + element + ">";
+            }
+            if (!declared_.count(name)) fail("unknown type '" + name + "'");
+            return name;
+        }
+
+        void checkName(std::set<std::string>& names, const std::string& name) {
+            if (!names.insert(name).second) fail("duplicate name '" + name + "'");
+        }
+
+        void parseMessage() {
+            expect("message");
+            Message message;
+            message.name = identifier();
+            if (!declared_.insert(message.name).second) fail("duplicate type '" + message.name + "'");
+            expect("{");
+            std::set<std::string> names;
+            while (!peek("}")) {
+                Field field;
+                field.type = type(field.scalar);
+                field.name = identifier();
+                checkName(names, field.name);
+                expect(";");
+                message.fields.push_back(field);
+            }
+            expect("}");
+            messages_.push_back(message);
+        }
+
+        void parseService() {
+            expect("service");
+            Service service;
+            service.name = identifier();
+            expect("{");
+            std::set<std::string> names;
+            std::map<uint32_t, std::string> ids;
+            while (!peek("}")) {
+                Method method;
+                bool scalar;
+                method.return_type = type(scalar, true);
+                method.name = identifier();
+                checkName(names, method.name);
+                expect("(");
+                while (!peek(")")) {
+                    if (!method.params.empty()) expect(",");
+                    Field param;
+                    param.type = type(param.scalar);
+                    param.name = identifier();
+                    method.params.push_back(param);
+                }
+                expect(")");
+                expect(";");
+                method.id = fnv1a(service.name + "." + method.name);
+                if (method.id == 0 || ids.count(method.id)) {
+                    fail("method id collision for '" + method.name + "', please rename it");
+                }
+                ids[method.id] = method.name;
+                service.methods.push_back(method);
+            }
+            expect("}");
+            services_.push_back(service);
+        }
+
+        std::vector<Token> tokens_;
+        size_t pos_;
+        std::string package_;
+        std::set<std::string> declared_;
+        std::vector<Message> messages_;
+        std::vector<Service> services_;
+};
+
+std::string paramList(const std::vector<Field>& params) {
+    std::string out;
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (i > 0) out += ", ";
+        out += params[i].scalar ? params[i].type + " " : "const " + params[i].type + "& ";
+        out += params[i].name;
+    }
+    return out;
+}
+
+std::string hex(uint32_t id) {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "0x%08xu", id);
+    return buffer;
+}
+
+std::string generate(const Parser& parser, const std::string& source_name) {
+    std::ostringstream out;
+    std::string ns = parser.package();
+    std::string qualify = ns.empty() ? "" : ns + "::";
+
+    out << "// 由trpc_idlgen根据" << source_name << "生成，不要手动修改\n"
+        << "#pragma once\n\n"
+        << "#include <cstdint>\n#include <string>\n#include <vector>\n#include <tuple>\n#include <future>\n\n"
+        << "#include \"codec.hpp\"\n#include \"service.hpp\"\n#include \"client.hpp\"\n\n";
+
+    if (!ns.empty()) out << "namespace " << ns << " {\n\n";
+    for (const auto& message : parser.messages()) {
+        out << "struct " << message.name << " {\n";
+        for (const auto& field : message.fields) {
+            out << "    " << field.type << " " << field.name << (field.scalar ? "{};\n" : ";\n");
+        }
+        out << "};\n\n";
+    }
+    if (!ns.empty()) out << "} // namespace " << ns << "\n\n";
+
+    // 每个message的定长编码：字段按声明顺序依次编码，没有字段标签
+    if (!parser.messages().empty()) {
+        out << "namespace trpc {\n\n";
+        for (const auto& message : parser.messages()) {
+            std::string full = qualify + message.name;
+            out << "template <>\nstruct Codec<" << full << "> {\n"
+                << "    static void encode(std::string& out, const " << full << "& value) {\n";
+            for (const auto& field : message.fields) {
+                out << "        Codec<" << field.type << ">::encode(out, value." << field.name << ");\n";
+            }
+            if (message.fields.empty()) out << "        (void)out;\n        (void)value;\n";
+            out << "    }\n\n"
+                << "    static " << full << " decode(BinaryReader& reader) {\n"
+                << "        " << full << " value;\n";
+            if (message.fields.empty()) out << "        (void)reader;\n";
+            for (const auto& field : message.fields) {
+                out << "        value." << field.name << " = Codec<" << field.type << ">::decode(reader);\n";
+            }
+            out << "        return value;\n    }\n};\n\n";
+        }
+        out << "} // namespace trpc\n\n";
+    }
+
+    if (!ns.empty()) out << "namespace " << ns << " {\n\n";
+    for (const auto& service : parser.services()) {
+        const std::string& name = service.name;
+
+        out << "struct " << name << "MethodIds {\n";
+        for (const auto& method : service.methods) {
+            out << "    static constexpr uint32_t " << method.name << " = " << hex(method.id) << ";\n";
+        }
+        out << "};\n\n";
+
+        out << "class " << name << "Client {\n"
+            << "    public:\n"
+            << "        explicit " << name << "Client(RPCClient& client) : client_(client) {}\n";
+        for (const auto& method : service.methods) {
+            out << "\n        std::future<" << method.return_type << "> " << method.name << "("
+                << paramList(method.params) << ") {\n"
+                << "            return client_.callById<" << method.return_type << ">(" << name << "MethodIds::"
+                << method.name;
+            for (const auto& param : method.params) out << ", " << param.name;
+            out << ");\n        }\n";
+        }
+        out << "\n    private:\n        RPCClient& client_;\n};\n\n";
+
+        out << "class " << name << "Skeleton : public trpc::IdlService {\n"
+            << "    public:\n"
+            << "        " << name << "Skeleton() : IdlService(\"" << name << "\", {\n";
+        for (const auto& method : service.methods) {
+            out << "            {" << name << "MethodIds::" << method.name << ", \"" << method.name << "\"},\n";
+        }
+        out << "        }) {}\n\n";
+        for (const auto& method : service.methods) {
+            out << "        virtual " << method.return_type << " " << method.name << "("
+                << paramList(method.params) << ") = 0;\n";
+        }
+        out << "\n        void dispatch(uint32_t method_id, trpc::BinaryReader& reader, std::string& out) override {\n"
+            << "            switch (method_id) {\n";
+        for (const auto& method : service.methods) {
+            out << "                case " << name << "MethodIds::" << method.name << ": {\n"
+                << "                    auto args = trpc::decodeValues<";
+            for (size_t i = 0; i < method.params.size(); ++i) {
+                out << (i > 0 ? ", " : "") << method.params[i].type;
+            }
+            out << ">(reader);\n";
+            std::string call = method.name + "(";
+            for (size_t i = 0; i < method.params.size(); ++i) {
+                call += (i > 0 ? ", " : "") + std::string("std::get<") + std::to_string(i) + ">(args)";
+            }
+            call += ")";
+            if (method.return_type == "void") {
+                out << "                    " << call << ";\n";
+            } else {
+                out << "                    trpc::Codec<" << method.return_type << ">::encode(out, " << call << ");\n";
+            }
+            if (method.params.empty()) out << "                    (void)args;\n";
+            out << "                    return;\n                }\n";
+        }
+        out << "            }\n"
+            << "            throw std::runtime_error(\"Unknown method id for " << name << "\");\n"
+            << "        }\n};\n\n";
+    }
+    if (!ns.empty()) out << "} // namespace " << ns << "\n";
+    return out.str();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " <input.idl> <output.hpp>" << std::endl;
+        return 2;
+    }
+    try {
+        std::ifstream input(argv[1]);
+        if (!input) throw std::runtime_error("cannot open " + std::string(argv[1]));
+        std::stringstream source;
+        source << input.rdbuf();
+
+        Parser parser(tokenize(source.str()));
+        parser.parse();
+
+        std::string name = argv[1];
+        size_t slash = name.find_last_of('/');
+        if (slash != std::string::npos) name = name.substr(slash + 1);
+
+        std::ofstream output(argv[2]);
+        if (!output) throw std::runtime_error("cannot write " + std::string(argv[2]));
+        output << generate(parser, name);
+    } catch (const std::exception& e) {
+        std::cerr << argv[1] << ": " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+    请求内存
+    +Arena ： 按块的指针碰撞分配器，请求处理期间的临时数据(参数数组、缓存键等)从这里分配，
+     不逐个释放，响应发送后reset()整体回收；reset后保留最后一块，稳态下不再向系统申请内存
+    +SlabPool ： 固定大小对象的池，按slab成批构造对象，归还的对象reset()后留在池中复用，
+     对象持有的缓冲区(如std::string的容量)也一起复用；不加锁，只能在一个线程中使用
+*/
+namespace trpc {
+
+// reset()时超过该大小的缓冲区还给系统，避免一次大请求让池中的对象长期占用内存
+constexpr size_t kRetainedBufferSize = 64 * 1024;
+
+class Arena {
+    public:
+        explicit Arena(size_t initial_size = 4096) : initial_size_(initial_size) {}
+
+        ~Arena() { release(head_); }
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        Arena(Arena&& other) noexcept
+            : initial_size_(other.initial_size_), head_(other.head_), used_(other.used_) {
+            other.head_ = nullptr;
+            other.used_ = 0;
+        }
+
+        Arena& operator=(Arena&& other) noexcept {
+            if (this != &other) {
+                release(head_);
+                initial_size_ = other.initial_size_;
+                head_ = other.head_;
+                used_ = other.used_;
+                other.head_ = nullptr;
+                other.used_ = 0;
+            }
+            return *this;
+        }
+
+        void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+            size_t offset = (used_ + align - 1) & ~(align - 1);
+            if (!head_ || offset + size > head_->size) {
+                grow(size + align);
+                offset = (used_ + align - 1) & ~(align - 1);
+            }
+            used_ = offset + size;
+            return head_->data() + offset;
+        }
+
+        // 只用于无需析构的类型，reset时不调用析构函数
+        template <typename T>
+        T* allocateArray(size_t count) {
+            static_assert(std::is_trivially_destructible<T>::value, "Arena does not run destructors");
+            return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        }
+
+        // 把几段字符串依次拼接到arena中
+        std::string_view concat(std::initializer_list<std::string_view> parts) {
+            size_t size = 0;
+            for (std::string_view part : parts) size += part.size();
+            char* out = static_cast<char*>(allocate(size, 1));
+            char* cursor = out;
+            for (std::string_view part : parts) {
+                memcpy(cursor, part.data(), part.size());
+                cursor += part.size();
+            }
+            return std::string_view(out, size);
+        }
+
+        // 回收全部分配；保留最后(也是最大)的一块，除非它超过kRetainedBufferSize
+        void reset() {
+            if (!head_) return;
+            release(head_->prev);
+            head_->prev = nullptr;
+            if (head_->size > kRetainedBufferSize) {
+                release(head_);
+                head_ = nullptr;
+            }
+            used_ = 0;
+        }
+
+        // 当前持有的块的总大小
+        size_t capacity() const {
+            size_t total = 0;
+            for (Chunk* chunk = head_; chunk; chunk = chunk->prev) total += chunk->size;
+            return total;
+        }
+
+    private:
+        struct Chunk {
+            Chunk* prev;
+            size_t size;
+
+            char* data() { return reinterpret_cast<char*>(this) + sizeof(Chunk); }
+        };
+
+        static_assert(sizeof(Chunk) % alignof(std::max_align_t) == 0, "Chunk data must stay aligned");
+
+        // 新块至少是上一块的两倍，一个请求内的分配次数与数据量成对数关系
+        void grow(size_t min_size) {
+            size_t size = head_ ? head_->size * 2 : initial_size_;
+            while (size < min_size) size *= 2;
+            Chunk* chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + size));
+            chunk->prev = head_;
+            chunk->size = size;
+            head_ = chunk;
+            used_ = 0;
+        }
+
+        static void release(Chunk* chunk) {
+            while (chunk) {
+                Chunk* prev = chunk->prev;
+                ::operator delete(chunk);
+                chunk = prev;
+            }
+        }
+
+        size_t initial_size_;
+        Chunk* head_ = nullptr;     // 当前分配所在的块，prev指向更早的块
+        size_t used_ = 0;           // head_中已用的字节数
+};
+
+// T需要提供reset()，在归还时清空状态并保留可复用的缓冲区
+template <typename T>
+class SlabPool {
+    public:
+        explicit SlabPool(size_t objects_per_slab = 64) : per_slab_(objects_per_slab) {}
+
+        ~SlabPool() {
+            for (size_t i = 0; i < slabs_.size(); ++i) {
+                size_t constructed = i + 1 == slabs_.size() ? next_ : per_slab_;
+                for (size_t j = 0; j < constructed; ++j) slabs_[i][j].~T();
+                ::operator delete(slabs_[i], std::align_val_t(alignof(T)));
+            }
+        }
+
+        SlabPool(const SlabPool&) = delete;
+        SlabPool& operator=(const SlabPool&) = delete;
+
+        // 优先复用归还的对象，池空时才在slab中构造新对象
+        T* acquire() {
+            if (!free_.empty()) {
+                T* object = free_.back();
+                free_.pop_back();
+                return object;
+            }
+            if (slabs_.empty() || next_ == per_slab_) {
+                slabs_.push_back(static_cast<T*>(::operator new(sizeof(T) * per_slab_,
+                                                                std::align_val_t(alignof(T)))));
+                next_ = 0;
+                free_.reserve(slabs_.size() * per_slab_);
+            }
+            return new (slabs_.back() + next_++) T();
+        }
+
+        void release(T* object) {
+            object->reset();
+            free_.push_back(object);
+        }
+
+        // 已构造的对象数和其中空闲的对象数
+        size_t allocated() const { return slabs_.empty() ? 0 : (slabs_.size() - 1) * per_slab_ + next_; }
+        size_t idle() const { return free_.size(); }
+
+    private:
+        size_t per_slab_;
+        std::vector<T*> slabs_;
+        size_t next_ = 0;           // 最后一个slab中下一个未构造的位置
+        std::vector<T*> free_;      // 容量预留为全部对象数，归还时不会扩容
+};
+
+// 清空字符串；容量超过kRetainedBufferSize时还给系统
+inline void resetBuffer(std::string& buffer) {
+    if (buffer.capacity() > kRetainedBufferSize) {
+        std::string().swap(buffer);
+    } else {
+        buffer.clear();
+    }
+}
+
+} // namespace trpc
@@ -9,12 +9,18 @@
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <vector>
+#include <chrono>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <cstring>
 #include "json.hpp"
+#include "protocol.hpp"
+#include "codec.hpp"
+#include "status.hpp"
 
 class MessageQueue {
 public:
@@ -22,7 +28,9 @@ public:
         std::string service_name;
         std::string method_name;
         std::string request_data;
-        std::promise<std::string> response_promise;
+        std::string payload;
+        std::promise<trpc::Frame> response_promise;
+        bool batchable = false;     // 可以与其他调用合并为一个批量请求
     };
 
     void push(Message&& msg) {
@@ -31,129 +39,521 @@ public:
         cv_.notify_one();
     }
 
-    Message pop() {
+    // 队列关闭且为空时返回false
+    bool pop(Message& msg) {
         std::unique_lock<std::mutex> lock(mutex_);
-        cv_.wait(lock, [this] { return !queue_.empty(); });
-        auto msg = std::move(queue_.front());
+        cv_.wait(lock, [this] { return !queue_.empty() || closed_; });
+        if (queue_.empty()) return false;
+        msg = std::move(queue_.front());
         queue_.pop();
-        return msg;
+        return true;
+    }
+
+    // 队首消息满足pred时取出；等到deadline仍为空或队首不满足时返回false
+    template <typename Pred>
+    bool popIf(Message& msg, std::chrono::steady_clock::time_point deadline, Pred pred) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!cv_.wait_until(lock, deadline, [this] { return !queue_.empty() || closed_; })) return false;
+        if (queue_.empty() || !pred(queue_.front())) return false;
+        msg = std::move(queue_.front());
+        queue_.pop();
+        return true;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size();
+    }
+
+    // 唤醒阻塞在pop上的线程，已入队的消息仍会被取出
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        cv_.notify_all();
     }
 
 private:
     std::queue<Message> queue_;
     std::mutex mutex_;
     std::condition_variable cv_;
+    bool closed_ = false;
+};
+
+// 表达式DAG构造器：add返回节点编号，ref(i)可以作为后续节点的参数，由服务端一次求值
+class ExprGraph {
+public:
+    size_t add(const std::string& op, nlohmann::json args) {
+        nodes_.push_back({{"op", op}, {"args", std::move(args)}});
+        return nodes_.size() - 1;
+    }
+
+    static nlohmann::json ref(size_t node) {
+        return {{"$ref", node}};
+    }
+
+    // 标记需要返回的节点，不调用时返回全部节点
+    void output(size_t node) {
+        outputs_.push_back(node);
+    }
+
+    nlohmann::json toJson() const {
+        nlohmann::json graph;
+        graph["nodes"] = nodes_;
+        if (!outputs_.empty()) graph["outputs"] = outputs_;
+        return graph;
+    }
+
+private:
+    nlohmann::json nodes_ = nlohmann::json::array();
+    std::vector<size_t> outputs_;
+};
+
+// 客户端自动批量：发送线程发现调用堆积时，在窗口内继续收集后续调用，合并为一个批量请求发送；
+// 队列为空且上一次只发了一个调用时说明流量很低，直接发送，不增加延迟。
+// 默认关闭，保持每次调用一帧的原有行为；开启后同一帧内的调用共享一次往返
+struct ClientOptions {
+    bool auto_batch = false;
+    std::chrono::microseconds batch_window = std::chrono::microseconds(50);
+    size_t max_batch_calls = 64;
+    size_t max_batch_bytes = 64 * 1024;
+};
+
+struct ClientStats {
+    static constexpr size_t kBuckets = 8;
+
+    uint64_t frames;                    // 发出的请求帧数
+    uint64_t calls;                     // 其中包含的调用数
+    uint64_t batch_sizes[kBuckets];     // 每帧调用数的分布：1, 2~3, 4~7, ..., 128以上
+
+    double averageBatchSize() const {
+        return frames == 0 ? 0.0 : static_cast<double>(calls) / frames;
+    }
 };
 
 class RPCClient {
 public:
-    RPCClient(const std::string& server_ip, int port) 
-        : server_ip_(server_ip), port_(port), running_(true) {
+    // server_ip为"unix://路径"时连接服务端的Unix域socket，忽略port
+    RPCClient(const std::string& server_ip, int port, const ClientOptions& options = ClientOptions())
+        : server_ip_(server_ip), port_(port), options_(options), running_(true) {
+        if (server_ip_.compare(0, kUnixScheme.size(), kUnixScheme) == 0) {
+            unix_path_ = server_ip_.substr(kUnixScheme.size());
+        }
         // 启动消息处理线程
         worker_thread_ = std::thread(&RPCClient::processMessages, this);
     }
 
     ~RPCClient() {
         running_ = false;
+        message_queue_.close();
         if (worker_thread_.joinable()) {
             worker_thread_.join();
         }
     }
 
+    ClientStats getStats() const {
+        ClientStats stats;
+        stats.frames = frames_.load(std::memory_order_relaxed);
+        stats.calls = calls_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < ClientStats::kBuckets; ++i) {
+            stats.batch_sizes[i] = batch_sizes_[i].load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
     template<typename T>
     std::future<T> callAsync(const std::string& service_name, 
                            const std::string& method_name,
                            const std::vector<T>& args) {
-        // 创建promise和future
-        std::promise<std::string> response_promise;
-        auto response_future = response_promise.get_future();
+        auto response_future = enqueue(service_name, method_name, args, std::string());
 
-        // 构造请求
+        // 返回future，允许异步获取结果
+        return std::async(std::launch::deferred, [response_future = std::move(response_future)]() mutable {
+            return parseResult(response_future.get().meta).template get<T>();
+        });
+    }
+
+    // 在服务端求值表达式DAG，按output的顺序返回各节点结果
+    std::future<std::vector<nlohmann::json>> callGraphAsync(const std::string& service_name,
+                                                            const ExprGraph& graph) {
+        auto response_future = enqueue(service_name, "eval", graph.toJson(), std::string());
+        return std::async(std::launch::deferred, [response_future = std::move(response_future)]() mutable {
+            return parseResult(response_future.get().meta).get<std::vector<nlohmann::json>>();
+        });
+    }
+
+    // 带调试标记的调用：服务端记录该请求各阶段的耗时(微秒)，随结果一起返回；
+    // 不与其他调用合并，send阶段在响应发出之后才结束，不包含在内
+    struct TracedResult {
+        nlohmann::json result;
+        nlohmann::json trace;
+    };
+
+    std::future<TracedResult> callTracedAsync(const std::string& service_name,
+                                              const std::string& method_name,
+                                              const nlohmann::json& args) {
+        nlohmann::json request = makeRequest(service_name, method_name, args);
+        request["trace"] = true;
+        auto response_future = enqueueFrame(service_name, method_name, request.dump(), std::string(), false);
+        return std::async(std::launch::deferred, [response_future = std::move(response_future)]() mutable {
+            auto response = nlohmann::json::parse(response_future.get().meta);
+            nlohmann::json trace = response.contains("trace") ? response["trace"] : nlohmann::json();
+            if (response.contains("error")) {
+                throw trpc::StatusError(responseStatus(response));
+            }
+            return TracedResult{std::move(response["result"]), std::move(trace)};
+        });
+    }
+
+    // 读取服务端指标：连接统计和各方法的请求数、错误数、缓存命中、排队/执行耗时分布；
+    // 内置服务在事件循环线程处理，不能放进批量请求
+    std::future<nlohmann::json> callStats() {
+        auto response_future = enqueueFrame("_trpc", "stats", makeRequest("_trpc", "stats", nlohmann::json::array()).dump(),
+                                            std::string(), false);
+        return std::async(std::launch::deferred, [response_future = std::move(response_future)]() mutable {
+            return parseResult(response_future.get().meta);
+        });
+    }
+
+    // 带二进制payload的调用(如矩阵运算)，结果中的payload为服务端返回的二进制数据
+    struct BinaryResult {
+        nlohmann::json result;
+        std::string payload;
+    };
+
+    std::future<BinaryResult> callBinaryAsync(const std::string& service_name,
+                                              const std::string& method_name,
+                                              const nlohmann::json& args,
+                                              std::string payload) {
+        auto response_future = enqueue(service_name, method_name, args, std::move(payload));
+        return std::async(std::launch::deferred, [response_future = std::move(response_future)]() mutable {
+            trpc::Frame frame = response_future.get();
+            return BinaryResult{parseResult(frame.meta), std::move(frame.payload)};
+        });
+    }
+
+    // 调用TypedService的方法：参数按声明类型二进制编码，返回值按R解码，不经过JSON
+    template <typename R, typename... Args>
+    std::future<R> callTyped(const std::string& service_name, const std::string& method_name,
+                             const Args&... args) {
+        nlohmann::json request;
+        request["service_name"] = service_name;
+        request["method_name"] = method_name;
+        auto response_future = enqueueFrame(service_name, method_name, request.dump(),
+                                            trpc::encodeValues(args...), false);
+        return std::async(std::launch::deferred, [response_future = std::move(response_future)]() mutable {
+            trpc::Frame frame = response_future.get();
+            parseResult(frame.meta);
+            if constexpr (!std::is_void<R>::value) {
+                trpc::BinaryReader reader(frame.payload);
+                return std::get<0>(trpc::decodeValues<R>(reader));
+            }
+        });
+    }
+
+    // 按方法id调用IDL生成的服务，由生成的客户端存根使用；
+    // 帧的meta为空，payload为 | 方法id(4B) | 参数 |，成功的响应meta也为空
+    template <typename R, typename... Args>
+    std::future<R> callById(uint32_t method_id, const Args&... args) {
+        std::string payload;
+        trpc::Codec<uint32_t>::encode(payload, method_id);
+        trpc::encodeValuesTo(payload, args...);
+        auto response_future = enqueueFrame(std::string(), std::string(), std::string(), std::move(payload), false);
+        return std::async(std::launch::deferred, [response_future = std::move(response_future)]() mutable {
+            trpc::Frame frame = response_future.get();
+            if (!frame.meta.empty()) {
+                parseResult(frame.meta);
+            }
+            if constexpr (!std::is_void<R>::value) {
+                trpc::BinaryReader reader(frame.payload);
+                return std::get<0>(trpc::decodeValues<R>(reader));
+            }
+        });
+    }
+
+    // 批量调用：多个互相独立的调用放在一个帧里，服务端并行执行后一次返回
+    struct BatchCall {
+        std::string service_name;
+        std::string method_name;
+        nlohmann::json args;
+    };
+
+    // 单个调用的结果，失败时error为错误描述，code为错误码
+    struct CallResult {
+        nlohmann::json result;
+        std::string error;
+        trpc::ErrorCode code = trpc::ErrorCode::Ok;
+
+        bool ok() const { return code == trpc::ErrorCode::Ok; }
+    };
+
+    std::future<std::vector<CallResult>> callBatch(const std::vector<BatchCall>& calls) {
+        nlohmann::json batch = nlohmann::json::array();
+        for (const auto& call : calls) {
+            batch.push_back(makeRequest(call.service_name, call.method_name, call.args));
+        }
+        nlohmann::json request;
+        request["batch"] = std::move(batch);
+        auto response_future = enqueueFrame("batch", "batch", request.dump(), std::string(), false);
+
+        return std::async(std::launch::deferred, [response_future = std::move(response_future)]() mutable {
+            auto response = nlohmann::json::parse(response_future.get().meta);
+            if (response.contains("error")) {
+                // 整个批量请求被拒绝(如格式错误或超过上限)
+                throw trpc::StatusError(responseStatus(response));
+            }
+            std::vector<CallResult> results;
+            for (auto& item : response.at("batch")) {
+                if (item.contains("error")) {
+                    trpc::Status status = responseStatus(item);
+                    results.push_back(CallResult{nullptr, status.message(), status.code()});
+                } else {
+                    results.push_back(CallResult{std::move(item["result"]), std::string()});
+                }
+            }
+            return results;
+        });
+    }
+
+private:
+    static nlohmann::json makeRequest(const std::string& service_name, const std::string& method_name,
+                                      const nlohmann::json& args) {
         nlohmann::json request;
         request["service_name"] = service_name;
         request["method_name"] = method_name;
         request["args"] = args;
+        return request;
+    }
+
+    std::future<trpc::Frame> enqueue(const std::string& service_name, const std::string& method_name,
+                                     const nlohmann::json& args, std::string payload) {
+        bool batchable = payload.empty();
+        return enqueueFrame(service_name, method_name, makeRequest(service_name, method_name, args).dump(),
+                            std::move(payload), batchable);
+    }
+
+    std::future<trpc::Frame> enqueueFrame(const std::string& service_name, const std::string& method_name,
+                                          std::string request_data, std::string payload, bool batchable) {
+        // 创建promise和future
+        std::promise<trpc::Frame> response_promise;
+        auto response_future = response_promise.get_future();
 
         // 将消息放入队列
         MessageQueue::Message msg{
             service_name,
             method_name,
-            request.dump(),
-            std::move(response_promise)
+            std::move(request_data),
+            std::move(payload),
+            std::move(response_promise),
+            batchable
         };
         message_queue_.push(std::move(msg));
+        return response_future;
+    }
 
-        // 返回future，允许异步获取结果
-        return std::async(std::launch::deferred, [response_future = std::move(response_future)]() mutable {
-            auto response_str = response_future.get();
-            auto response = nlohmann::json::parse(response_str);
-            return response["result"].get<T>();
-        });
+    // 错误响应时抛出trpc::StatusError，可以按code()区分错误类型
+    static nlohmann::json parseResult(const std::string& meta) {
+        auto response = nlohmann::json::parse(meta);
+        if (response.contains("error")) {
+            throw trpc::StatusError(responseStatus(response));
+        }
+        return std::move(response["result"]);
     }
 
-private:
-    void processMessages() {
-        while (running_) {
-            try {
-                auto msg = message_queue_.pop();
-                
-                // 创建socket连接
-                int client_fd = socket(AF_INET, SOCK_STREAM, 0);
-                if (client_fd == -1) {
-                    msg.response_promise.set_exception(
-                        std::make_exception_ptr(std::runtime_error("Failed to create socket")));
-                    continue;
-                }
+    // 不带code的错误响应(如旧版本的服务端)按Internal处理
+    static trpc::Status responseStatus(const nlohmann::json& response) {
+        auto code = response.find("code");
+        int value = code != response.end() && code->is_number_integer() ? code->get<int>()
+                                                                         : static_cast<int>(trpc::ErrorCode::Internal);
+        return trpc::Status(trpc::errorCodeFromInt(value), response["error"].get<std::string>());
+    }
 
-                // 设置服务器地址
-                struct sockaddr_in server_addr;
-                server_addr.sin_family = AF_INET;
-                server_addr.sin_port = htons(port_);
-                server_addr.sin_addr.s_addr = inet_addr(server_ip_.c_str());
-
-                // 连接到服务器
-                if (connect(client_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) == -1) {
-                    msg.response_promise.set_exception(
-                        std::make_exception_ptr(std::runtime_error("Failed to connect to server")));
-                    close(client_fd);
-                    continue;
-                }
+    static bool sendAll(int fd, trpc::IOBuf& data) {
+        while (!data.empty()) {
+            if (data.sendTo(fd) == -1) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+        }
+        return true;
+    }
 
-                // 发送请求
-                if (send(client_fd, msg.request_data.c_str(), msg.request_data.size(), 0) == -1) {
-                    msg.response_promise.set_exception(
-                        std::make_exception_ptr(std::runtime_error("Failed to send request")));
-                    close(client_fd);
-                    continue;
-                }
+    static bool recvAll(int fd, char* buffer, size_t size) {
+        size_t received = 0;
+        while (received < size) {
+            ssize_t n = recv(fd, buffer + received, size - received, 0);
+            if (n == -1 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            received += static_cast<size_t>(n);
+        }
+        return true;
+    }
 
-                // 接收响应
-                char buffer[1024];
-                int bytes_received = recv(client_fd, buffer, sizeof(buffer), 0);
-                if (bytes_received == -1) {
-                    msg.response_promise.set_exception(
-                        std::make_exception_ptr(std::runtime_error("Failed to receive response")));
-                    close(client_fd);
-                    continue;
-                }
+    // 按地址类型连接TCP端口或Unix域socket，返回已连接的fd
+    int connectToServer() {
+        int client_fd = socket(unix_path_.empty() ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+        if (client_fd == -1) {
+            throw std::runtime_error("Failed to create socket");
+        }
 
-                // 设置响应结果
-                std::string response(buffer, bytes_received);
-                msg.response_promise.set_value(response);
-                
+        int result;
+        if (unix_path_.empty()) {
+            struct sockaddr_in server_addr;
+            server_addr.sin_family = AF_INET;
+            server_addr.sin_port = htons(port_);
+            server_addr.sin_addr.s_addr = inet_addr(server_ip_.c_str());
+            result = connect(client_fd, (struct sockaddr*)&server_addr, sizeof(server_addr));
+        } else {
+            struct sockaddr_un server_addr = {};
+            server_addr.sun_family = AF_UNIX;
+            if (unix_path_.size() >= sizeof(server_addr.sun_path)) {
                 close(client_fd);
-            } catch (const std::exception& e) {
-                // 处理异常
-                std::cerr << "Error processing message: " << e.what() << std::endl;
+                throw std::runtime_error("Unix socket path too long: " + unix_path_);
+            }
+            memcpy(server_addr.sun_path, unix_path_.data(), unix_path_.size());
+            result = connect(client_fd, (struct sockaddr*)&server_addr, sizeof(server_addr));
+        }
+        if (result == -1) {
+            close(client_fd);
+            throw std::runtime_error("Failed to connect to server");
+        }
+        return client_fd;
+    }
+
+    // 建立连接、发送一帧并读取响应帧，失败时抛出异常
+    trpc::Frame roundTrip(const std::string& meta, const std::string& payload) {
+        int client_fd = connectToServer();
+
+        // 发送请求：帧头和meta拷贝进池化块，payload(可能是几MB的矩阵)直接引用，不拼接成整帧
+        trpc::IOBuf frame;
+        trpc::appendFrameHeader(frame, meta.size(), payload.size());
+        frame.append(meta);
+        trpc::appendFramePadding(frame, meta.size());
+        frame.appendExternal(payload.data(), payload.size(), nullptr, nullptr);
+        if (!sendAll(client_fd, frame)) {
+            close(client_fd);
+            throw std::runtime_error("Failed to send request");
+        }
+
+        // 接收响应：先读帧头得到长度，再读meta、对齐填充和payload
+        char header[trpc::kFrameHeaderSize];
+        trpc::Frame response;
+        bool received = recvAll(client_fd, header, sizeof(header));
+        if (received) {
+            try {
+                size_t meta_size, payload_size;
+                trpc::decodeFrameHeader(header, meta_size, payload_size);
+                char padding[trpc::kPayloadAlignment];
+                response.meta.resize(meta_size);
+                response.payload.resize(payload_size);
+                received = recvAll(client_fd, &response.meta[0], meta_size)
+                        && recvAll(client_fd, padding, trpc::framePayloadOffset(meta_size) - trpc::kFrameHeaderSize - meta_size)
+                        && recvAll(client_fd, &response.payload[0], payload_size);
+            } catch (const std::exception&) {
+                received = false;
+            }
+        }
+        close(client_fd);
+        if (!received) {
+            throw std::runtime_error("Failed to receive response");
+        }
+        return response;
+    }
+
+    // 调用堆积时在窗口内继续收集可合并的调用，直到数量或字节数达到上限
+    void collectBatch(std::vector<MessageQueue::Message>& batch) {
+        if (message_queue_.size() == 0 && last_batch_size_ <= 1) return;
+
+        size_t bytes = batch.front().request_data.size();
+        auto deadline = std::chrono::steady_clock::now() + options_.batch_window;
+        MessageQueue::Message next;
+        while (batch.size() < options_.max_batch_calls && bytes < options_.max_batch_bytes
+               && message_queue_.popIf(next, deadline, [](const MessageQueue::Message& m) { return m.batchable; })) {
+            bytes += next.request_data.size();
+            batch.push_back(std::move(next));
+        }
+    }
+
+    // 每个调用的请求本身就是JSON对象，直接拼接成批量请求；
+    // 批量响应中的每一项与单个调用的响应格式相同，原样交给对应的promise
+    void sendBatch(std::vector<MessageQueue::Message>& batch) {
+        std::string meta = "{\"batch\":[";
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (i > 0) meta += ',';
+            meta += batch[i].request_data;
+        }
+        meta += "]}";
+
+        trpc::Frame response = roundTrip(meta, std::string());
+        auto reply = nlohmann::json::parse(response.meta);
+        if (reply.contains("error")) {
+            for (auto& msg : batch) msg.response_promise.set_value(trpc::Frame{response.meta, std::string()});
+            return;
+        }
+        auto& items = reply.at("batch");
+        if (!items.is_array() || items.size() != batch.size()) {
+            throw std::runtime_error("Malformed batch response");
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i].response_promise.set_value(trpc::Frame{items[i].dump(), std::string()});
+        }
+    }
+
+    void recordBatch(size_t size) {
+        frames_.fetch_add(1, std::memory_order_relaxed);
+        calls_.fetch_add(size, std::memory_order_relaxed);
+        size_t bucket = 0;
+        while (size > 1 && bucket + 1 < ClientStats::kBuckets) {
+            size >>= 1;
+            ++bucket;
+        }
+        batch_sizes_[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void processMessages() {
+        MessageQueue::Message msg;
+        std::vector<MessageQueue::Message> batch;
+        while (message_queue_.pop(msg)) {
+            batch.clear();
+            batch.push_back(std::move(msg));
+            if (options_.auto_batch && batch.front().batchable) {
+                collectBatch(batch);
+            }
+            last_batch_size_ = batch.size();
+            recordBatch(batch.size());
+
+            try {
+                if (batch.size() == 1) {
+                    MessageQueue::Message& single = batch.front();
+                    single.response_promise.set_value(roundTrip(single.request_data, single.payload));
+                } else {
+                    sendBatch(batch);
+                }
+            } catch (const std::exception&) {
+                // 连接或收发失败，本帧中的所有调用都以该异常结束
+                for (auto& failed : batch) {
+                    try {
+                        failed.response_promise.set_exception(std::current_exception());
+                    } catch (const std::future_error&) {
+                        // 该promise已经设置过结果
+                    }
+                }
             }
         }
     }
 
+    static inline const std::string kUnixScheme = "unix://";
+
     std::string server_ip_;
     int port_;
+    std::string unix_path_;     // 连接TCP端口时为空
+    ClientOptions options_;
     MessageQueue message_queue_;
     std::thread worker_thread_;
     std::atomic<bool> running_;
+    size_t last_batch_size_ = 0;        // 只在发送线程中访问
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> calls_{0};
+    std::atomic<uint64_t> batch_sizes_[ClientStats::kBuckets] = {};
 };
 
 
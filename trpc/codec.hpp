@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <stdexcept>
+#include <type_traits>
+
+/*
+    二进制编解码
+    +算术类型按本机字节序定长存放，bool占1字节
+    +std::string ： | 长度(4B) | 字节 |
+    +std::vector<T> ： | 元素个数(4B) | 元素 |；算术类型的元素前补0，使其相对消息开头按alignof(T)对齐，整体拷贝
+    +std::string_view和ArrayView<T>与std::string、std::vector<T>编码相同，
+     解码时不拷贝，直接指向接收缓冲区，只在缓冲区存活期间有效
+    +Codec<T>在编译期为每种类型生成编解码代码，不经过JSON
+*/
+namespace trpc {
+
+// 算术类型数组的只读视图，C++17没有std::span，接口取其子集
+template <typename T>
+class ArrayView {
+    public:
+        ArrayView() : data_(nullptr), size_(0) {}
+        ArrayView(const T* data, size_t size) : data_(data), size_(size) {}
+        ArrayView(const std::vector<T>& values) : data_(values.data()), size_(values.size()) {}
+
+        const T* data() const { return data_; }
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        const T* begin() const { return data_; }
+        const T* end() const { return data_ + size_; }
+        const T& operator[](size_t i) const { return data_[i]; }
+
+    private:
+        const T* data_;
+        size_t size_;
+};
+
+class BinaryReader {
+    public:
+        // base_offset为data相对消息开头的偏移，用于计算数组的对齐填充
+        BinaryReader(const char* data, size_t size, size_t base_offset = 0)
+            : data_(data), size_(size), offset_(0), base_offset_(base_offset) {}
+        explicit BinaryReader(std::string_view buffer) : BinaryReader(buffer.data(), buffer.size()) {}
+
+        const char* read(size_t n) {
+            if (n > size_ - offset_) {
+                throw std::invalid_argument("Truncated binary message");
+            }
+            const char* p = data_ + offset_;
+            offset_ += n;
+            return p;
+        }
+
+        uint32_t readLength() {
+            uint32_t n;
+            memcpy(&n, read(sizeof(n)), sizeof(n));
+            return n;
+        }
+
+        // 跳过对齐填充
+        void align(size_t alignment) {
+            read((alignment - (base_offset_ + offset_) % alignment) % alignment);
+        }
+
+        bool done() const { return offset_ == size_; }
+
+    private:
+        const char* data_;
+        size_t size_;
+        size_t offset_;
+        size_t base_offset_;
+};
+
+inline void writeLength(std::string& out, size_t n) {
+    if (n > UINT32_MAX) {
+        throw std::length_error("Binary field too long");
+    }
+    uint32_t length = static_cast<uint32_t>(n);
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+}
+
+// out从消息开头开始写，按当前长度补0对齐
+inline void writePadding(std::string& out, size_t alignment) {
+    out.append((alignment - out.size() % alignment) % alignment, '\0');
+}
+
+template <typename T>
+constexpr bool kIsPodElement = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value;
+
+// 算术类型数组的公共编码
+template <typename T>
+inline void encodeArray(std::string& out, const T* values, size_t n) {
+    writeLength(out, n);
+    writePadding(out, alignof(T));
+    out.append(reinterpret_cast<const char*>(values), n * sizeof(T));
+}
+
+// 返回指向reader内部的指针，先按长度取出数据，伪造的元素个数不会导致超大分配
+template <typename T>
+inline const char* decodeArray(BinaryReader& reader, uint32_t& n) {
+    n = reader.readLength();
+    reader.align(alignof(T));
+    return reader.read(static_cast<size_t>(n) * sizeof(T));
+}
+
+template <typename T, typename = void>
+struct Codec {
+    static_assert(sizeof(T) == 0, "No binary codec for this type");
+};
+
+template <typename T>
+struct Codec<T, std::enable_if_t<std::is_arithmetic<T>::value>> {
+    static void encode(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static T decode(BinaryReader& reader) {
+        T value;
+        memcpy(&value, reader.read(sizeof(T)), sizeof(T));
+        return value;
+    }
+};
+
+template <>
+struct Codec<std::string> {
+    static void encode(std::string& out, const std::string& value) {
+        writeLength(out, value.size());
+        out.append(value);
+    }
+
+    static std::string decode(BinaryReader& reader) {
+        uint32_t n = reader.readLength();
+        return std::string(reader.read(n), n);
+    }
+};
+
+template <>
+struct Codec<std::string_view> {
+    static void encode(std::string& out, std::string_view value) {
+        writeLength(out, value.size());
+        out.append(value.data(), value.size());
+    }
+
+    static std::string_view decode(BinaryReader& reader) {
+        uint32_t n = reader.readLength();
+        return std::string_view(reader.read(n), n);
+    }
+};
+
+template <typename T>
+struct Codec<std::vector<T>> {
+    static void encode(std::string& out, const std::vector<T>& values) {
+        if constexpr (kIsPodElement<T>) {
+            encodeArray(out, values.data(), values.size());
+        } else {
+            writeLength(out, values.size());
+            for (const auto& value : values) Codec<T>::encode(out, value);
+        }
+    }
+
+    static std::vector<T> decode(BinaryReader& reader) {
+        if constexpr (kIsPodElement<T>) {
+            uint32_t n;
+            const char* p = decodeArray<T>(reader, n);
+            std::vector<T> values(n);
+            memcpy(values.data(), p, static_cast<size_t>(n) * sizeof(T));
+            return values;
+        } else {
+            uint32_t n = reader.readLength();
+            std::vector<T> values;
+            for (uint32_t i = 0; i < n; ++i) values.push_back(Codec<T>::decode(reader));
+            return values;
+        }
+    }
+};
+
+// 缓冲区本身按8字节对齐(见protocol.hpp)时，对齐填充保证了视图中的元素地址对齐
+template <typename T>
+struct Codec<ArrayView<T>> {
+    static_assert(kIsPodElement<T>, "ArrayView only supports arithmetic element types");
+
+    static void encode(std::string& out, ArrayView<T> values) {
+        encodeArray(out, values.data(), values.size());
+    }
+
+    static ArrayView<T> decode(BinaryReader& reader) {
+        uint32_t n;
+        const char* p = decodeArray<T>(reader, n);
+        if (reinterpret_cast<uintptr_t>(p) % alignof(T) != 0) {
+            throw std::invalid_argument("Misaligned array in binary message");
+        }
+        return ArrayView<T>(reinterpret_cast<const T*>(p), n);
+    }
+};
+
+// 依次编码多个值，用于请求参数；out须从消息开头开始写
+template <typename... Args>
+inline void encodeValuesTo(std::string& out, const Args&... values) {
+    (Codec<std::decay_t<Args>>::encode(out, values), ...);
+}
+
+template <typename... Args>
+inline std::string encodeValues(const Args&... values) {
+    std::string out;
+    encodeValuesTo(out, values...);
+    return out;
+}
+
+// 按声明顺序解码，花括号初始化保证从左到右求值；多余的字节视为格式错误
+template <typename... Args>
+inline std::tuple<Args...> decodeValues(BinaryReader& reader) {
+    std::tuple<Args...> values{Codec<Args>::decode(reader)...};
+    if (!reader.done()) {
+        throw std::invalid_argument("Unexpected trailing bytes in binary message");
+    }
+    return values;
+}
+
+} // namespace trpc
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <algorithm>
+
+#include "json.hpp"
+#include "threadpool.hpp"
+#include "status.hpp"
+
+/*
+    表达式DAG
+    +一次请求携带多个计算节点，后面的节点可以用{"$ref": i}引用第i个节点的结果
+    +格式 ： {"nodes": [{"op": "add", "args": [5, 3]}, {"op": "mul", "args": [{"$ref": 0}, 2]}], "outputs": [1]}
+    +outputs省略时返回全部节点的结果
+    +只能引用更早的节点，因此不会有环；按依赖深度分层，同一层的节点互不依赖，交给线程池并行执行
+*/
+namespace trpc {
+
+constexpr size_t kMaxDagNodes = 1024;
+
+class ExprDag {
+    public:
+        using Evaluator = std::function<nlohmann::json(const std::string& op, const nlohmann::json& args)>;
+
+        explicit ExprDag(const nlohmann::json& graph) {
+            const auto& nodes = graph.at("nodes");
+            if (!nodes.is_array() || nodes.empty() || nodes.size() > kMaxDagNodes) {
+                throw std::invalid_argument("DAG must have 1 to " + std::to_string(kMaxDagNodes) + " nodes");
+            }
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                Node node;
+                node.op = nodes[i].at("op").get<std::string>();
+                node.args = nodes[i].at("args");
+                collectRefs(node.args, i, node.deps);
+                size_t level = 0;
+                for (size_t dep : node.deps) level = std::max(level, nodes_[dep].level + 1);
+                node.level = level;
+                if (level >= levels_.size()) levels_.resize(level + 1);
+                levels_[level].push_back(i);
+                nodes_.push_back(std::move(node));
+            }
+
+            if (graph.contains("outputs")) {
+                for (const auto& output : graph["outputs"]) {
+                    size_t index = output.get<size_t>();
+                    if (index >= nodes_.size()) {
+                        throw std::out_of_range("DAG output refers to unknown node " + std::to_string(index));
+                    }
+                    outputs_.push_back(index);
+                }
+            } else {
+                for (size_t i = 0; i < nodes_.size(); ++i) outputs_.push_back(i);
+            }
+        }
+
+        // 逐层求值，返回outputs对应的结果数组；任一节点失败时抛出StatusError，保留错误码并带上节点编号
+        nlohmann::json evaluate(const Evaluator& evaluator, ThreadPool* pool) const {
+            std::vector<nlohmann::json> results(nodes_.size());
+            for (const auto& level : levels_) {
+                parallelFor(pool, level.size(), 1, [&](size_t, size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i) {
+                        size_t index = level[i];
+                        const Node& node = nodes_[index];
+                        try {
+                            nlohmann::json args = node.deps.empty() ? node.args : resolve(node.args, results);
+                            results[index] = evaluator(node.op, args);
+                        } catch (const std::exception& e) {
+                            Status status = statusFromException(e);
+                            throw StatusError(Status(status.code(), "DAG node " + std::to_string(index) + " ("
+                                                                    + node.op + "): " + status.message()));
+                        }
+                    }
+                });
+            }
+
+            nlohmann::json outputs = nlohmann::json::array();
+            for (size_t index : outputs_) outputs.push_back(results[index]);
+            return outputs;
+        }
+
+        size_t size() const { return nodes_.size(); }
+        size_t depth() const { return levels_.size(); }
+
+    private:
+        struct Node {
+            std::string op;
+            nlohmann::json args;
+            std::vector<size_t> deps;
+            size_t level = 0;
+        };
+
+        static bool isRef(const nlohmann::json& value) {
+            return value.is_object() && value.size() == 1 && value.contains("$ref");
+        }
+
+        static void collectRefs(const nlohmann::json& value, size_t self, std::vector<size_t>& deps) {
+            if (isRef(value)) {
+                size_t target = value["$ref"].get<size_t>();
+                if (target >= self) {
+                    throw std::invalid_argument("DAG node " + std::to_string(self) + " may only refer to earlier nodes");
+                }
+                if (std::find(deps.begin(), deps.end(), target) == deps.end()) deps.push_back(target);
+                return;
+            }
+            if (value.is_structured()) {
+                for (const auto& item : value) collectRefs(item, self, deps);
+            }
+        }
+
+        // 把参数中的引用替换为对应节点的结果
+        static nlohmann::json resolve(const nlohmann::json& value, const std::vector<nlohmann::json>& results) {
+            if (isRef(value)) return results[value["$ref"].get<size_t>()];
+            if (value.is_array()) {
+                nlohmann::json resolved = nlohmann::json::array();
+                for (const auto& item : value) resolved.push_back(resolve(item, results));
+                return resolved;
+            }
+            if (value.is_object()) {
+                nlohmann::json resolved = nlohmann::json::object();
+                for (auto it = value.begin(); it != value.end(); ++it) resolved[it.key()] = resolve(it.value(), results);
+                return resolved;
+            }
+            return value;
+        }
+
+        std::vector<Node> nodes_;
+        std::vector<std::vector<size_t>> levels_;
+        std::vector<size_t> outputs_;
+};
+
+} // namespace trpc
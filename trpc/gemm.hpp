@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#include "simd.hpp"
+#include "threadpool.hpp"
+
+/*
+    稠密矩阵乘法
+    +gemm ： C(m×n) = A(m×k) · B(k×n)，行主序
+    +gemv ： y(m) = A(m×n) · x(n)，行主序
+    +按GotoBLAS的方式分块：B按KC×NC打包，A按MC×KC打包，
+     最内层是MR×NR的寄存器分块微内核(AVX2/FMA，其余走标量实现)
+    +C按MC行切块分给线程池，调用线程也参与计算
+    +int32的乘加在int32内完成，溢出时按补码回绕
+*/
+namespace trpc {
+namespace simd {
+
+namespace detail {
+
+// 每个类型的分块参数：微内核为MR行×(NV个向量)列
+template <typename T> struct GemmShape {
+    static constexpr size_t MR = 4, NR = 4;
+};
+template <> struct GemmShape<float> {
+    static constexpr size_t MR = 6, NR = 16;
+};
+template <> struct GemmShape<double> {
+    static constexpr size_t MR = 6, NR = 8;
+};
+template <> struct GemmShape<int32_t> {
+    static constexpr size_t MR = 6, NR = 16;
+};
+
+constexpr size_t kGemmMC = 120;     // A块在L2中
+constexpr size_t kGemmKC = 256;     // 一列微面板在L1中
+constexpr size_t kGemmNC = 2048;    // B面板在L3中
+
+// 打包A的mc×kc块：每MR行一组，按k展开，不足MR行补0
+template <typename T>
+inline void packA(size_t mc, size_t kc, const T* a, size_t lda, T* buf) {
+    constexpr size_t MR = GemmShape<T>::MR;
+    for (size_t i0 = 0; i0 < mc; i0 += MR) {
+        size_t rows = std::min(MR, mc - i0);
+        for (size_t p = 0; p < kc; ++p) {
+            for (size_t i = 0; i < MR; ++i) {
+                *buf++ = i < rows ? a[(i0 + i) * lda + p] : T(0);
+            }
+        }
+    }
+}
+
+// 打包B的kc×nc块：每NR列一组，按k展开，不足NR列补0
+template <typename T>
+inline void packB(size_t kc, size_t nc, const T* b, size_t ldb, T* buf) {
+    constexpr size_t NR = GemmShape<T>::NR;
+    for (size_t j0 = 0; j0 < nc; j0 += NR) {
+        size_t cols = std::min(NR, nc - j0);
+        for (size_t p = 0; p < kc; ++p) {
+            const T* row = b + p * ldb + j0;
+            if (cols == NR) {
+                std::copy(row, row + NR, buf);
+            } else {
+                std::copy(row, row + cols, buf);
+                std::fill(buf + cols, buf + NR, T(0));
+            }
+            buf += NR;
+        }
+    }
+}
+
+// 标量微内核：c(MR×NR) += a · b
+template <typename T>
+inline void microKernelScalar(size_t kc, const T* a, const T* b, T* c, size_t ldc) {
+    constexpr size_t MR = GemmShape<T>::MR, NR = GemmShape<T>::NR;
+    T acc[MR][NR] = {};
+    for (size_t p = 0; p < kc; ++p) {
+        for (size_t i = 0; i < MR; ++i) {
+            for (size_t j = 0; j < NR; ++j) {
+                acc[i][j] += a[i] * b[j];
+            }
+        }
+        a += MR;
+        b += NR;
+    }
+    for (size_t i = 0; i < MR; ++i) {
+        for (size_t j = 0; j < NR; ++j) {
+            c[i * ldc + j] += acc[i][j];
+        }
+    }
+}
+
+#ifdef TRPC_SIMD_X86
+
+// AVX2微内核：MR×NV个累加寄存器常驻，每步广播一个a元素，与NV个b向量做乘加
+template <class Ops>
+TRPC_TARGET_AVX2 inline void microKernelAvx2(size_t kc, const typename Ops::T* a,
+                                             const typename Ops::T* b,
+                                             typename Ops::T* c, size_t ldc) {
+    using T = typename Ops::T;
+    using V = typename Ops::V;
+    constexpr size_t MR = GemmShape<T>::MR;
+    constexpr size_t W = Ops::kWidth;
+    constexpr size_t NV = GemmShape<T>::NR / W;
+
+    V acc[MR][NV];
+#pragma GCC unroll 8
+    for (size_t i = 0; i < MR; ++i) {
+#pragma GCC unroll 4
+        for (size_t j = 0; j < NV; ++j) acc[i][j] = Ops::load(c + i * ldc + j * W);
+    }
+    for (size_t p = 0; p < kc; ++p) {
+        V bv[NV];
+#pragma GCC unroll 4
+        for (size_t j = 0; j < NV; ++j) bv[j] = Ops::load(b + j * W);
+#pragma GCC unroll 8
+        for (size_t i = 0; i < MR; ++i) {
+            V av = Ops::set1(a[i]);
+#pragma GCC unroll 4
+            for (size_t j = 0; j < NV; ++j) acc[i][j] = Ops::fmadd(av, bv[j], acc[i][j]);
+        }
+        a += MR;
+        b += NV * W;
+    }
+#pragma GCC unroll 8
+    for (size_t i = 0; i < MR; ++i) {
+#pragma GCC unroll 4
+        for (size_t j = 0; j < NV; ++j) Ops::store(c + i * ldc + j * W, acc[i][j]);
+    }
+}
+
+#endif // TRPC_SIMD_X86
+
+template <typename T>
+inline void microKernel(size_t kc, const T* a, const T* b, T* c, size_t ldc) {
+#ifdef TRPC_SIMD_X86
+    if constexpr (kHasVectorKernel<T>) {
+        if (activeIsa() == Isa::AVX2) {
+            microKernelAvx2<typename IsaOps<T>::Avx2>(kc, a, b, c, ldc);
+            return;
+        }
+    }
+#endif
+    microKernelScalar(kc, a, b, c, ldc);
+}
+
+// 计算C的一个mc×nc块，A块和B面板均已打包
+template <typename T>
+inline void macroKernel(size_t mc, size_t nc, size_t kc, const T* apack, const T* bpack,
+                        T* c, size_t ldc) {
+    constexpr size_t MR = GemmShape<T>::MR, NR = GemmShape<T>::NR;
+    T edge[MR * NR];
+    for (size_t jr = 0; jr < nc; jr += NR) {
+        size_t cols = std::min(NR, nc - jr);
+        for (size_t ir = 0; ir < mc; ir += MR) {
+            size_t rows = std::min(MR, mc - ir);
+            const T* a = apack + ir * kc;
+            const T* b = bpack + jr * kc;
+            T* tile = c + ir * ldc + jr;
+            if (rows == MR && cols == NR) {
+                microKernel(kc, a, b, tile, ldc);
+                continue;
+            }
+            // 边角块先算到临时缓冲区再累加回C，避免越界
+            std::fill(edge, edge + MR * NR, T(0));
+            microKernel(kc, a, b, edge, NR);
+            for (size_t i = 0; i < rows; ++i) {
+                for (size_t j = 0; j < cols; ++j) tile[i * ldc + j] += edge[i * NR + j];
+            }
+        }
+    }
+}
+
+} // namespace detail
+
+// C = A · B，A为m×k，B为k×n，C为m×n，均为行主序且紧密存放；pool为空时单线程执行
+template <typename T>
+inline void gemm(size_t m, size_t n, size_t k, const T* a, const T* b, T* c,
+                 ThreadPool* pool = nullptr) {
+    using namespace detail;
+    constexpr size_t NR = GemmShape<T>::NR, MR = GemmShape<T>::MR;
+    std::fill(c, c + m * n, T(0));
+    if (m == 0 || n == 0 || k == 0) return;
+
+    // 计算量太小时并行调度的开销大于收益
+    if (m * n * k < (1u << 21)) pool = nullptr;
+
+    std::vector<T> bpack(kGemmKC * ((std::min(n, kGemmNC) + NR - 1) / NR * NR));
+    size_t mblocks = (m + kGemmMC - 1) / kGemmMC;
+    for (size_t jc = 0; jc < n; jc += kGemmNC) {
+        size_t nc = std::min(kGemmNC, n - jc);
+        for (size_t pc = 0; pc < k; pc += kGemmKC) {
+            size_t kc = std::min(kGemmKC, k - pc);
+            packB(kc, nc, b + pc * n + jc, n, bpack.data());
+            parallelFor(pool, mblocks, 1, [&](size_t, size_t begin, size_t end) {
+                std::vector<T> apack(kGemmMC * kc + MR * kc);
+                for (size_t block = begin; block < end; ++block) {
+                    size_t ic = block * kGemmMC;
+                    size_t mc = std::min(kGemmMC, m - ic);
+                    packA(mc, kc, a + ic * k + pc, k, apack.data());
+                    macroKernel(mc, nc, kc, apack.data(), bpack.data(), c + ic * n + jc, n);
+                }
+            });
+        }
+    }
+}
+
+// y = A · x，A为m×n行主序；每行是一次内积，按行切块并行
+template <typename T>
+inline void gemv(size_t m, size_t n, const T* a, const T* x, T* y, ThreadPool* pool = nullptr) {
+    if (m * n < (1u << 18)) pool = nullptr;
+    size_t grain = std::max<size_t>(1, (1u << 16) / std::max<size_t>(n, 1));
+    parallelFor(pool, m, grain, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            y[i] = static_cast<T>(dot(a + i * n, x, n));
+        }
+    });
+}
+
+} // namespace simd
+} // namespace trpc
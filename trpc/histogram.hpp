@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+/*
+    延迟直方图
+    +按HDR直方图的方式分桶：每个2的幂区间再线性分为2^(SubBucketBits-1)个子桶，
+     覆盖0~2^64的全部取值，桶数固定，记录为O(1)
+    +LatencyHistogram每个区间64个子桶，相对误差不超过1/64
+    +不加锁，每个线程各用一个，最后merge到一起
+*/
+namespace trpc {
+
+template <int SubBucketBits>
+class LogLinearHistogram {
+    public:
+        static constexpr int kSubBucketBits = SubBucketBits;
+        static constexpr uint64_t kSubBucketCount = 1ull << kSubBucketBits;
+        static constexpr uint64_t kSubBucketHalf = kSubBucketCount / 2;
+        static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketHalf + kSubBucketHalf;
+
+        LogLinearHistogram() : counts_(kBucketCount, 0), total_(0), sum_(0),
+                               min_(std::numeric_limits<uint64_t>::max()), max_(0) {}
+
+        void record(uint64_t value) {
+            ++counts_[indexOf(value)];
+            ++total_;
+            sum_ += value;
+            min_ = std::min(min_, value);
+            max_ = std::max(max_, value);
+        }
+
+        void merge(const LogLinearHistogram& other) {
+            for (size_t i = 0; i < kBucketCount; ++i) counts_[i] += other.counts_[i];
+            total_ += other.total_;
+            sum_ += other.sum_;
+            min_ = std::min(min_, other.min_);
+            max_ = std::max(max_, other.max_);
+        }
+
+        // 从按同样方式分桶的外部计数(如原子计数)汇总：先逐桶加入计数，再补上总和与最值
+        void addBucket(size_t index, uint64_t n) {
+            counts_[index] += n;
+            total_ += n;
+        }
+
+        void addSummary(uint64_t sum, uint64_t min, uint64_t max) {
+            sum_ += sum;
+            min_ = std::min(min_, min);
+            max_ = std::max(max_, max);
+        }
+
+        void reset() {
+            std::fill(counts_.begin(), counts_.end(), 0);
+            total_ = sum_ = max_ = 0;
+            min_ = std::numeric_limits<uint64_t>::max();
+        }
+
+        uint64_t count() const { return total_; }
+        uint64_t min() const { return total_ == 0 ? 0 : min_; }
+        uint64_t max() const { return max_; }
+        uint64_t sum() const { return sum_; }
+        double mean() const { return total_ == 0 ? 0.0 : static_cast<double>(sum_) / total_; }
+
+        // 返回不小于percentile%样本的最小桶上界，与HDR直方图一样取桶内最大等价值，不超过实际最大值
+        uint64_t valueAtPercentile(double percentile) const {
+            if (total_ == 0) return 0;
+            double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100.0;
+            uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * total_ + 0.5));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBucketCount; ++i) {
+                seen += counts_[i];
+                if (seen >= target) return std::min(highestEquivalent(i), max_);
+            }
+            return max_;
+        }
+
+        // 小于kSubBucketCount的值直接作下标；更大的值右移到[half, count)，移位数决定所在区间
+        static size_t indexOf(uint64_t value) {
+            if (value < kSubBucketCount) return static_cast<size_t>(value);
+            int shift = 63 - __builtin_clzll(value) - (kSubBucketBits - 1);
+            return static_cast<size_t>(shift) * kSubBucketHalf + static_cast<size_t>(value >> shift);
+        }
+
+        static uint64_t highestEquivalent(size_t index) {
+            if (index < kSubBucketCount) return index;
+            size_t shift = index / kSubBucketHalf - 1;
+            uint64_t sub = index - shift * kSubBucketHalf;
+            return ((sub + 1) << shift) - 1;
+        }
+
+    private:
+        std::vector<uint64_t> counts_;
+        uint64_t total_;
+        uint64_t sum_;
+        uint64_t min_;
+        uint64_t max_;
+};
+
+using LatencyHistogram = LogLinearHistogram<7>;
+
+} // namespace trpc
@@ -0,0 +1,415 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/errqueue.h>
+
+/*
+    发送缓冲区
+    +IOBuf ： 由若干块的片段组成的链，编码时直接写进块中，发送时用sendmsg把各片段一次交给内核，不拼接成连续内存
+    +IOBlock ： 带引用计数的内存块，多个IOBuf可以共享同一块(如缓存命中时的Redis回复)，最后一个引用释放时回收
+     - 池化块：固定kIOBlockSize字节，来自IOBlockPool，小块数据(帧头、JSON响应)拷贝进来
+     - 外部块：接管一个std::string或外部内存(由释放函数回收)，较大的数据不拷贝
+    +IOBlockPool ： 每个线程缓存一批空闲块，工作线程编码、事件循环线程发送后释放时，多余的块成批还给全局池
+    +ZeroCopyTracker ： MSG_ZEROCOPY发送时内核在完成前一直引用用户内存，已发送的片段留在这里，
+     从错误队列收到完成通知后才释放
+*/
+namespace trpc {
+
+constexpr size_t kIOBlockSize = 8192;           // 池化块的容量
+constexpr size_t kIOCopyThreshold = 4096;       // 不超过该大小的std::string拷贝进池化块，更大的直接接管
+constexpr size_t kMaxSendIovecs = 64;           // 一次sendmsg最多携带的片段数
+
+struct IOBlock {
+    std::atomic<uint32_t> refs{1};
+    bool pooled = false;
+    char* data = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;                        // 已写入的字节数；只有独占的池化块可以继续追加
+    void (*free_fn)(void*) = nullptr;       // 外部块的释放函数，为空表示不需要释放
+    void* context = nullptr;
+
+    void ref() { refs.fetch_add(1, std::memory_order_relaxed); }
+    inline void unref();
+
+    bool writable() const { return pooled && used < capacity && refs.load(std::memory_order_relaxed) == 1; }
+};
+
+class IOBlockPool {
+    public:
+        static IOBlock* acquire() {
+            Cache& cache = local();
+            if (cache.blocks.empty()) refill(cache);
+            IOBlock* block;
+            if (cache.blocks.empty()) {
+                void* memory = ::operator new(sizeof(IOBlock) + kIOBlockSize);
+                block = new (memory) IOBlock();
+                block->pooled = true;
+                block->data = reinterpret_cast<char*>(block + 1);
+                block->capacity = kIOBlockSize;
+            } else {
+                block = cache.blocks.back();
+                cache.blocks.pop_back();
+                block->refs.store(1, std::memory_order_relaxed);
+                block->used = 0;
+            }
+            return block;
+        }
+
+        static void release(IOBlock* block) {
+            Cache& cache = local();
+            cache.blocks.push_back(block);
+            if (cache.blocks.size() > kLocalLimit) spill(cache, kTransferBatch);
+        }
+
+    private:
+        static constexpr size_t kLocalLimit = 64;       // 每个线程最多缓存的空闲块
+        static constexpr size_t kTransferBatch = 32;    // 与全局池之间一次转移的块数
+        static constexpr size_t kSharedLimit = 1024;    // 全局池最多保留的空闲块，超出的还给系统
+
+        struct Shared {
+            std::mutex mutex;
+            std::vector<IOBlock*> blocks;
+
+            ~Shared() {
+                for (IOBlock* block : blocks) destroy(block);
+            }
+        };
+
+        struct Cache {
+            std::vector<IOBlock*> blocks;
+
+            // 先构造全局池，保证它在各线程的缓存之后析构
+            Cache() { shared(); }
+
+            ~Cache() { spill(*this, blocks.size()); }
+        };
+
+        static Shared& shared() {
+            static Shared pool;
+            return pool;
+        }
+
+        static Cache& local() {
+            thread_local Cache cache;
+            return cache;
+        }
+
+        static void refill(Cache& cache) {
+            Shared& pool = shared();
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            size_t count = std::min(kTransferBatch, pool.blocks.size());
+            cache.blocks.insert(cache.blocks.end(), pool.blocks.end() - count, pool.blocks.end());
+            pool.blocks.resize(pool.blocks.size() - count);
+        }
+
+        static void spill(Cache& cache, size_t count) {
+            Shared& pool = shared();
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            for (size_t i = 0; i < count; ++i) {
+                IOBlock* block = cache.blocks.back();
+                cache.blocks.pop_back();
+                if (pool.blocks.size() < kSharedLimit) {
+                    pool.blocks.push_back(block);
+                } else {
+                    destroy(block);
+                }
+            }
+        }
+
+        static void destroy(IOBlock* block) {
+            block->~IOBlock();
+            ::operator delete(block);
+        }
+};
+
+inline void IOBlock::unref() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    if (pooled) {
+        IOBlockPool::release(this);
+        return;
+    }
+    if (free_fn) free_fn(context);
+    this->~IOBlock();
+    ::operator delete(this);
+}
+
+class IOBuf {
+    public:
+        IOBuf() = default;
+
+        IOBuf(const IOBuf& other) { append(other); }
+
+        IOBuf& operator=(const IOBuf& other) {
+            if (this != &other) {
+                clear();
+                append(other);
+            }
+            return *this;
+        }
+
+        IOBuf(IOBuf&& other) noexcept
+            : slices_(std::move(other.slices_)), front_(other.front_), size_(other.size_) {
+            other.slices_.clear();
+            other.front_ = 0;
+            other.size_ = 0;
+        }
+
+        IOBuf& operator=(IOBuf&& other) noexcept {
+            if (this != &other) {
+                clear();
+                slices_.swap(other.slices_);
+                front_ = other.front_;
+                size_ = other.size_;
+                other.front_ = 0;
+                other.size_ = 0;
+            }
+            return *this;
+        }
+
+        ~IOBuf() { clear(); }
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        size_t sliceCount() const { return slices_.size() - front_; }
+
+        // 拷贝到末尾的池化块中，块写满时再取一块
+        void append(const void* data, size_t size) {
+            const char* in = static_cast<const char*>(data);
+            while (size > 0) {
+                if (!tailWritable()) {
+                    IOBlock* block = IOBlockPool::acquire();
+                    slices_.push_back(Slice{block, block->data, 0});
+                }
+                Slice& tail = slices_.back();
+                size_t n = std::min(size, tail.block->capacity - tail.block->used);
+                memcpy(tail.block->data + tail.block->used, in, n);
+                tail.block->used += n;
+                tail.size += n;
+                size_ += n;
+                in += n;
+                size -= n;
+            }
+        }
+
+        void append(std::string_view text) { append(text.data(), text.size()); }
+
+        // 较小的字符串拷贝；较大的接管其内存，与字符串头放在同一次分配中
+        void append(std::string&& text) {
+            if (text.size() <= kIOCopyThreshold) {
+                append(text.data(), text.size());
+                return;
+            }
+            void* memory = ::operator new(sizeof(IOBlock) + sizeof(std::string));
+            IOBlock* block = new (memory) IOBlock();
+            std::string* owned = new (static_cast<IOBlock*>(memory) + 1) std::string(std::move(text));
+            block->data = &(*owned)[0];
+            block->capacity = block->used = owned->size();
+            block->free_fn = [](void* s) { static_cast<std::string*>(s)->~basic_string(); };
+            block->context = owned;
+            pushSlice(block, block->data, owned->size());
+        }
+
+        // 共享other的所有块，不拷贝数据
+        void append(const IOBuf& other) {
+            for (size_t i = other.front_; i < other.slices_.size(); ++i) {
+                const Slice& slice = other.slices_[i];
+                slice.block->ref();
+                pushSlice(slice.block, slice.data, slice.size);
+            }
+        }
+
+        // 引用外部内存，最后一个引用释放时调用free_fn(context)；free_fn为空时调用方保证内存在发送完之前有效
+        void appendExternal(const char* data, size_t size, void (*free_fn)(void*), void* context) {
+            IOBlock* block = new IOBlock();
+            block->data = const_cast<char*>(data);
+            block->capacity = block->used = size;
+            block->free_fn = free_fn;
+            block->context = context;
+            pushSlice(block, block->data, size);
+        }
+
+        // 释放所有块，片段数组的容量留给下一次使用
+        void clear() {
+            for (size_t i = front_; i < slices_.size(); ++i) slices_[i].block->unref();
+            slices_.clear();
+            front_ = 0;
+            size_ = 0;
+        }
+
+        // 丢弃开头size个字节(已发送的部分)，整个片段发送完时释放对块的引用；
+        // into不为空时这些字节转移到into的末尾，块的引用随之转移
+        void consume(size_t size, IOBuf* into = nullptr) {
+            size_ -= size;
+            while (size > 0) {
+                Slice& slice = slices_[front_];
+                if (size < slice.size) {
+                    if (into) {
+                        slice.block->ref();
+                        into->pushSlice(slice.block, slice.data, size);
+                    }
+                    slice.data += size;
+                    slice.size -= size;
+                    return;
+                }
+                size -= slice.size;
+                if (into) {
+                    into->pushSlice(slice.block, slice.data, slice.size);
+                } else {
+                    slice.block->unref();
+                }
+                ++front_;
+            }
+            if (front_ == slices_.size()) {
+                slices_.clear();
+                front_ = 0;
+            }
+        }
+
+        // 填充最多max个iovec，返回填充的个数
+        size_t fillIovec(struct iovec* iov, size_t max) const {
+            size_t count = 0;
+            for (size_t i = front_; i < slices_.size() && count < max; ++i, ++count) {
+                iov[count].iov_base = const_cast<char*>(slices_[i].data);
+                iov[count].iov_len = slices_[i].size;
+            }
+            return count;
+        }
+
+        // 一次sendmsg发送尽可能多的片段，已发送的部分丢弃或转移到sent；返回值与sendmsg相同
+        ssize_t sendTo(int fd, int flags = MSG_NOSIGNAL, IOBuf* sent = nullptr) {
+            struct iovec iov[kMaxSendIovecs];
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = fillIovec(iov, kMaxSendIovecs);
+            ssize_t n = sendmsg(fd, &msg, flags);
+            if (n > 0) consume(static_cast<size_t>(n), sent);
+            return n;
+        }
+
+        // 拼接为连续的字符串，只用于需要改写内容等少数场合
+        std::string toString() const {
+            std::string out;
+            out.reserve(size_);
+            for (size_t i = front_; i < slices_.size(); ++i) out.append(slices_[i].data, slices_[i].size);
+            return out;
+        }
+
+    private:
+        struct Slice {
+            IOBlock* block;
+            const char* data;
+            size_t size;
+        };
+
+        // 末尾片段恰好到块的写入位置为止、且块没有被共享时，可以继续追加
+        bool tailWritable() const {
+            if (slices_.size() == front_) return false;
+            const Slice& tail = slices_.back();
+            return tail.block->writable() && tail.data + tail.size == tail.block->data + tail.block->used;
+        }
+
+        void pushSlice(IOBlock* block, const char* data, size_t size) {
+            if (size == 0) {
+                block->unref();
+                return;
+            }
+            slices_.push_back(Slice{block, data, size});
+            size_ += size;
+        }
+
+        std::vector<Slice> slices_;
+        size_t front_ = 0;          // 第一个未发送的片段
+        size_t size_ = 0;
+};
+
+// 每个socket一个，只在发送该socket的线程中使用
+class ZeroCopyTracker {
+    public:
+        // 为socket开启SO_ZEROCOPY；不支持的socket(如AF_UNIX)或内核返回false
+        static bool enable(int fd) {
+            int one = 1;
+            return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+        }
+
+        // 以MSG_ZEROCOPY发送data，已发送的部分保留到完成通知到达；返回值与sendmsg相同。
+        // 未读取的通知占满optmem_max时内核返回ENOBUFS，先收取通知，这一次退回普通发送
+        ssize_t send(int fd, IOBuf& data) {
+            IOBuf sent;
+            ssize_t n = data.sendTo(fd, MSG_NOSIGNAL | MSG_ZEROCOPY, &sent);
+            if (n == -1 && errno == ENOBUFS) {
+                reap(fd);
+                return data.sendTo(fd);
+            }
+            if (n >= 0) pending_.push_back(Pending{next_seq_++, false, std::move(sent)});
+            return n;
+        }
+
+        // 读取错误队列中所有的完成通知并释放对应的数据，返回其中被内核退回拷贝的发送次数
+        // (如回环连接，接收端仍要拷贝一次)
+        uint32_t reap(int fd) {
+            uint32_t copied = 0;
+            while (!pending_.empty()) {
+                char control[128];
+                struct msghdr msg = {};
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof(control);
+                if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) break;
+                for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+                    auto* err = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+                    if (err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+                    // 一条通知覆盖序号区间[ee_info, ee_data]，序号按32位回绕
+                    uint32_t count = complete(err->ee_info, err->ee_data);
+                    if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) copied += count;
+                }
+            }
+            return copied;
+        }
+
+        bool idle() const { return pending_.empty(); }
+
+        // 只能在idle()之后调用：即使socket已关闭，内核在发出完成通知之前仍可能读取这些数据，
+        // 提前释放会让块回到池中被下一个响应改写。还有未完成的发送时应连同fd一起保留到通知收齐
+        void reset() {
+            pending_.clear();
+            next_seq_ = 0;
+        }
+
+    private:
+        struct Pending {
+            uint32_t seq;
+            bool done;
+            IOBuf data;
+        };
+
+        uint32_t complete(uint32_t first, uint32_t last) {
+            uint32_t count = 0;
+            for (Pending& pending : pending_) {
+                if (!pending.done && pending.seq - first <= last - first) {
+                    pending.done = true;
+                    ++count;
+                }
+            }
+            // 通知通常按序到达，从队首释放已完成的发送
+            while (!pending_.empty() && pending_.front().done) pending_.pop_front();
+            return count;
+        }
+
+        std::deque<Pending> pending_;   // 按序号排列
+        uint32_t next_seq_ = 0;         // 内核为每次成功的零拷贝发送分配的序号，从0开始
+};
+
+} // namespace trpc
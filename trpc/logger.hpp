@@ -0,0 +1,406 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+
+/*
+    异步日志
+    +TRPC_LOG(LogLevel::Error, "Failed to {}: {}", what, code)
+     调用线程只把时间戳、调用点和参数的二进制编码写进本线程的环形缓冲区，不加锁、不格式化、不做系统调用
+    +每个线程一个单生产者单消费者环形缓冲区，后台线程定期取出所有线程的记录，按时间排序、格式化后一次write
+    +每个调用点每秒最多记录rate_limit条，超出的只计数，由后台线程汇总输出；缓冲区满时丢弃并计数
+    +格式串中的{}依次替换为参数，参数支持整数、浮点、bool、字符串，过长的字符串被截断
+*/
+namespace trpc {
+
+enum class LogLevel : uint8_t {
+    Debug,
+    Info,
+    Warn,
+    Error
+};
+
+// 调用点：TRPC_LOG展开为一个静态对象，第一次记录时登记到Logger，用于限速和统计被抑制的条数
+struct LogSite {
+    LogLevel level;
+    const char* file;
+    int line;
+    const char* format;
+    std::atomic<uint64_t> window{0};        // 当前限速窗口(秒)
+    std::atomic<uint32_t> window_count{0};  // 窗口内已记录的条数
+    std::atomic<uint64_t> suppressed{0};    // 因限速未记录、尚未报告的条数
+    std::atomic<bool> registered{false};
+    LogSite* next = nullptr;
+
+    LogSite(LogLevel lvl, const char* f, int l, const char* fmt) : level(lvl), file(f), line(l), format(fmt) {}
+};
+
+struct LoggerStats {
+    uint64_t written;       // 已输出的记录数
+    uint64_t dropped;       // 缓冲区满而丢弃的记录数
+    uint64_t suppressed;    // 因调用点限速而未记录的条数
+};
+
+class Logger {
+    public:
+        static constexpr size_t kRecordSize = 256;
+        static constexpr size_t kRingRecords = 1024;
+
+        // 进程内唯一，故意不析构：退出时仍在运行的线程可以继续记录，atexit时输出剩余记录
+        static Logger& instance() {
+            static Logger* logger = [] {
+                Logger* created = new Logger();
+                std::atexit([] { Logger::instance().flush(); });
+                return created;
+            }();
+            return *logger;
+        }
+
+        void setMinLevel(LogLevel level) { min_level_.store(level, std::memory_order_relaxed); }
+        void setRateLimit(uint32_t per_second) { rate_limit_.store(per_second, std::memory_order_relaxed); }
+        void setOutputFd(int fd) { output_fd_.store(fd, std::memory_order_relaxed); }
+
+        bool enabled(LogLevel level) const {
+            return level >= min_level_.load(std::memory_order_relaxed);
+        }
+
+        template <typename... Args>
+        void log(LogSite& site, const Args&... args) {
+            if (!enabled(site.level) || !admit(site)) return;
+            Ring& ring = localRing();
+            uint64_t head = ring.head.load(std::memory_order_relaxed);
+            if (head - ring.tail.load(std::memory_order_acquire) == kRingRecords) {
+                ring.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            Record& record = ring.records[head & (kRingRecords - 1)];
+            record.timestamp = realtimeNanos();
+            record.site = &site;
+            char* p = record.args;
+            char* end = record.args + sizeof(record.args);
+            // 放不下的参数及其后的参数都不再编码，否则后面的参数会错位到前面的占位符
+            record.truncated = !(encodeArg(p, end, args) && ...);
+            record.size = static_cast<uint16_t>(p - record.args);
+            ring.head.store(head + 1, std::memory_order_release);
+        }
+
+        // 同步取出并输出目前所有记录，用于退出前或测试
+        void flush() {
+            std::lock_guard<std::mutex> lock(flush_mutex_);
+            drain(true);
+        }
+
+        LoggerStats stats() const {
+            LoggerStats out{written_.load(std::memory_order_relaxed), 0, suppressed_total_.load(std::memory_order_relaxed)};
+            for (Ring* ring = rings_.load(std::memory_order_acquire); ring; ring = ring->next) {
+                out.dropped += ring->dropped.load(std::memory_order_relaxed);
+            }
+            for (LogSite* site = sites_.load(std::memory_order_acquire); site; site = site->next) {
+                out.suppressed += site->suppressed.load(std::memory_order_relaxed);
+            }
+            return out;
+        }
+
+    private:
+        enum class ArgType : uint8_t { Int, Uint, Double, Bool, String };
+
+        struct Record {
+            uint64_t timestamp;
+            LogSite* site;
+            uint16_t size;
+            bool truncated;                 // 有参数没能放进记录
+            char args[kRecordSize - sizeof(uint64_t) - sizeof(LogSite*) - sizeof(uint16_t) - sizeof(bool)];
+        };
+
+        // 单生产者(所属线程)单消费者(后台线程)；线程退出后由后台线程取完剩余记录，环形缓冲区本身保留复用
+        struct Ring {
+            alignas(64) std::atomic<uint64_t> head{0};
+            alignas(64) std::atomic<uint64_t> tail{0};
+            std::atomic<uint64_t> dropped{0};
+            std::atomic<bool> in_use{true};
+            Ring* next = nullptr;
+            Record records[kRingRecords];
+        };
+
+        Logger() : min_level_(LogLevel::Info), rate_limit_(100), output_fd_(STDERR_FILENO),
+                   rings_(nullptr), sites_(nullptr), written_(0), suppressed_total_(0) {
+            flusher_ = std::thread([this] { run(); });
+            flusher_.detach();
+        }
+
+        static uint64_t realtimeNanos() {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+        }
+
+        // 按秒分窗口计数；窗口切换时的少量竞争只会让个别记录多放行或多抑制一条
+        bool admit(LogSite& site) {
+            if (!site.registered.exchange(true, std::memory_order_acq_rel)) {
+                LogSite* head = sites_.load(std::memory_order_relaxed);
+                do {
+                    site.next = head;
+                } while (!sites_.compare_exchange_weak(head, &site, std::memory_order_release,
+                                                       std::memory_order_relaxed));
+            }
+            uint32_t limit = rate_limit_.load(std::memory_order_relaxed);
+            if (limit == 0) return true;
+            uint64_t now = static_cast<uint64_t>(time(nullptr));
+            if (site.window.load(std::memory_order_relaxed) != now) {
+                site.window.store(now, std::memory_order_relaxed);
+                site.window_count.store(0, std::memory_order_relaxed);
+            }
+            if (site.window_count.fetch_add(1, std::memory_order_relaxed) < limit) return true;
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // 线程第一次记录时领取一个空闲的环形缓冲区，没有时新建并挂到链表头
+        Ring& localRing() {
+            struct Holder {
+                Ring* ring = nullptr;
+                ~Holder() {
+                    if (ring) ring->in_use.store(false, std::memory_order_release);
+                }
+            };
+            thread_local Holder holder;
+            if (holder.ring) return *holder.ring;
+
+            for (Ring* ring = rings_.load(std::memory_order_acquire); ring; ring = ring->next) {
+                bool idle = false;
+                if (ring->in_use.compare_exchange_strong(idle, true, std::memory_order_acq_rel)) {
+                    holder.ring = ring;
+                    return *ring;
+                }
+            }
+            Ring* ring = new Ring();
+            Ring* head = rings_.load(std::memory_order_relaxed);
+            do {
+                ring->next = head;
+            } while (!rings_.compare_exchange_weak(head, ring, std::memory_order_release, std::memory_order_relaxed));
+            holder.ring = ring;
+            return *ring;
+        }
+
+        // 参数完整放进记录时返回true；字符串放不下时保留能放下的前缀，但同样返回false
+        template <typename T>
+        static bool encodeArg(char*& p, char* end, const T& value) {
+            if constexpr (std::is_same<T, bool>::value) {
+                return put(p, end, ArgType::Bool, &value, 1);
+            } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+                int64_t v = value;
+                return put(p, end, ArgType::Int, &v, sizeof(v));
+            } else if constexpr (std::is_integral<T>::value) {
+                uint64_t v = value;
+                return put(p, end, ArgType::Uint, &v, sizeof(v));
+            } else if constexpr (std::is_floating_point<T>::value) {
+                double v = value;
+                return put(p, end, ArgType::Double, &v, sizeof(v));
+            } else {
+                std::string_view text(value);
+                if (p + 3 > end) return false;
+                uint16_t n = static_cast<uint16_t>(std::min<size_t>(text.size(), end - p - 3));
+                *p++ = static_cast<char>(ArgType::String);
+                memcpy(p, &n, sizeof(n));
+                memcpy(p + sizeof(n), text.data(), n);
+                p += sizeof(n) + n;
+                return n == text.size();
+            }
+        }
+
+        static bool put(char*& p, char* end, ArgType type, const void* value, size_t size) {
+            if (p + 1 + size > end) return false;
+            *p++ = static_cast<char>(type);
+            memcpy(p, value, size);
+            p += size;
+            return true;
+        }
+
+        // 解码下一个参数并追加到out，没有更多参数时返回false
+        static bool appendArg(std::string& out, const char*& p, const char* end) {
+            if (p >= end) return false;
+            ArgType type = static_cast<ArgType>(*p++);
+            char number[32];
+            switch (type) {
+                case ArgType::Int: {
+                    int64_t v;
+                    memcpy(&v, p, sizeof(v));
+                    p += sizeof(v);
+                    snprintf(number, sizeof(number), "%lld", static_cast<long long>(v));
+                    break;
+                }
+                case ArgType::Uint: {
+                    uint64_t v;
+                    memcpy(&v, p, sizeof(v));
+                    p += sizeof(v);
+                    snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(v));
+                    break;
+                }
+                case ArgType::Double: {
+                    double v;
+                    memcpy(&v, p, sizeof(v));
+                    p += sizeof(v);
+                    snprintf(number, sizeof(number), "%g", v);
+                    break;
+                }
+                case ArgType::Bool:
+                    strcpy(number, *p++ ? "true" : "false");
+                    break;
+                case ArgType::String: {
+                    uint16_t n;
+                    memcpy(&n, p, sizeof(n));
+                    out.append(p + sizeof(n), n);
+                    p += sizeof(n) + n;
+                    return true;
+                }
+                default:
+                    return false;
+            }
+            out += number;
+            return true;
+        }
+
+        static const char* levelName(LogLevel level) {
+            switch (level) {
+                case LogLevel::Debug: return "D";
+                case LogLevel::Info: return "I";
+                case LogLevel::Warn: return "W";
+                default: return "E";
+            }
+        }
+
+        static const char* baseName(const char* path) {
+            const char* slash = strrchr(path, '/');
+            return slash ? slash + 1 : path;
+        }
+
+        static void appendPrefix(std::string& out, uint64_t timestamp, const LogSite& site) {
+            time_t seconds = static_cast<time_t>(timestamp / 1000000000ull);
+            struct tm tm;
+            localtime_r(&seconds, &tm);
+            char prefix[96];
+            size_t n = strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &tm);
+            snprintf(prefix + n, sizeof(prefix) - n, ".%06llu %s %s:%d ",
+                     static_cast<unsigned long long>(timestamp % 1000000000ull / 1000), levelName(site.level),
+                     baseName(site.file), site.line);
+            out += prefix;
+        }
+
+        static void format(std::string& out, const Record& record) {
+            appendPrefix(out, record.timestamp, *record.site);
+            const char* p = record.args;
+            const char* end = record.args + record.size;
+            bool marked = false;
+            for (const char* f = record.site->format; *f; ++f) {
+                if (f[0] == '{' && f[1] == '}') {
+                    if (!appendArg(out, p, end)) {
+                        // 没能放进记录的参数显示为{…}，与调用时少传参数的{}区分
+                        out += record.truncated ? "{…}" : "{}";
+                        marked = marked || record.truncated;
+                    }
+                    ++f;
+                } else {
+                    out += *f;
+                }
+            }
+            // 被截断的是最后一个字符串参数时没有剩下的占位符，在行尾标出
+            if (record.truncated && !marked) out += "…";
+            out += '\n';
+        }
+
+        // 取出所有线程的记录，按时间排序后格式化输出；限速抑制和丢弃的条数每秒最多报告一次，
+        // report_all时立即报告
+        void drain(bool report_all) {
+            std::vector<Record> batch;
+            for (Ring* ring = rings_.load(std::memory_order_acquire); ring; ring = ring->next) {
+                uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+                uint64_t head = ring->head.load(std::memory_order_acquire);
+                for (; tail != head; ++tail) batch.push_back(ring->records[tail & (kRingRecords - 1)]);
+                ring->tail.store(tail, std::memory_order_release);
+            }
+            std::stable_sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) {
+                return a.timestamp < b.timestamp;
+            });
+
+            std::string out;
+            for (const Record& record : batch) format(out, record);
+            written_.fetch_add(batch.size(), std::memory_order_relaxed);
+            uint64_t now = static_cast<uint64_t>(time(nullptr));
+            if (!report_all && now == reported_at_) {
+                writeAll(output_fd_.load(std::memory_order_relaxed), out);
+                return;
+            }
+            reported_at_ = now;
+            for (LogSite* site = sites_.load(std::memory_order_acquire); site; site = site->next) {
+                uint64_t suppressed = site->suppressed.exchange(0, std::memory_order_relaxed);
+                if (suppressed == 0) continue;
+                suppressed_total_.fetch_add(suppressed, std::memory_order_relaxed);
+                appendPrefix(out, realtimeNanos(), *site);
+                out += "suppressed " + std::to_string(suppressed) + " messages (rate limit)\n";
+            }
+            uint64_t dropped = 0;
+            for (Ring* ring = rings_.load(std::memory_order_acquire); ring; ring = ring->next) {
+                dropped += ring->dropped.load(std::memory_order_relaxed);
+            }
+            if (dropped != reported_dropped_) {
+                out += "logger: dropped " + std::to_string(dropped - reported_dropped_)
+                     + " records (buffer full)\n";
+                reported_dropped_ = dropped;
+            }
+            writeAll(output_fd_.load(std::memory_order_relaxed), out);
+        }
+
+        static void writeAll(int fd, const std::string& data) {
+            size_t written = 0;
+            while (written < data.size()) {
+                ssize_t n = write(fd, data.data() + written, data.size() - written);
+                if (n == -1 && errno == EINTR) continue;
+                if (n <= 0) return;
+                written += static_cast<size_t>(n);
+            }
+        }
+
+        void run() {
+            for (;;) {
+                std::this_thread::sleep_for(kFlushInterval);
+                std::lock_guard<std::mutex> lock(flush_mutex_);
+                drain(false);
+            }
+        }
+
+        static constexpr std::chrono::milliseconds kFlushInterval{5};
+
+        std::atomic<LogLevel> min_level_;
+        std::atomic<uint32_t> rate_limit_;
+        std::atomic<int> output_fd_;
+        std::atomic<Ring*> rings_;
+        std::atomic<LogSite*> sites_;
+        std::atomic<uint64_t> written_;
+        std::atomic<uint64_t> suppressed_total_;
+        uint64_t reported_dropped_ = 0;     // 以下两个只在持有flush_mutex_时访问
+        uint64_t reported_at_ = 0;
+        std::mutex flush_mutex_;
+        std::thread flusher_;
+};
+
+} // namespace trpc
+
+// 每个调用点一个静态LogSite；级别低于下限时不编码参数
+#define TRPC_LOG(level, format, ...)                                                        \
+    do {                                                                                    \
+        static ::trpc::LogSite trpc_log_site_(level, __FILE__, __LINE__, format);           \
+        ::trpc::Logger::instance().log(trpc_log_site_, ##__VA_ARGS__);                      \
+    } while (0)
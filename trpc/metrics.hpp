@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <limits>
+#include <cstdio>
+
+#include "json.hpp"
+#include "histogram.hpp"
+
+/*
+    服务端指标
+    +MethodMetrics ： 每个(服务, 方法)一份，记录请求数、错误数、缓存命中/未命中、
+     排队等待时间、执行时间和响应大小
+    +每个线程写自己的分片，计数和直方图都是原子变量，写入无锁也无争用；读取时把各分片合并成快照
+    +直方图每个2的幂区间8个子桶，相对误差不超过1/8，足以区分p99落在哪个量级
+    +快照可以输出为JSON(stats RPC)或Prometheus文本格式(管理端口)
+*/
+namespace trpc {
+
+using MetricHistogram = LogLinearHistogram<4>;
+
+// 线程在分片数组中的下标，线程数超过分片数时多个线程共用一个分片，原子操作保证计数不丢失
+constexpr size_t kMetricShards = 64;
+
+inline size_t metricShardIndex() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return index;
+}
+
+// 多线程可写的直方图，分桶方式与MetricHistogram相同
+class AtomicHistogram {
+    public:
+        AtomicHistogram() : sum_(0), min_(std::numeric_limits<uint64_t>::max()), max_(0) {
+            for (auto& count : counts_) count.store(0, std::memory_order_relaxed);
+        }
+
+        void record(uint64_t value) {
+            counts_[MetricHistogram::indexOf(value)].fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(value, std::memory_order_relaxed);
+            uint64_t current = min_.load(std::memory_order_relaxed);
+            while (value < current && !min_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+            current = max_.load(std::memory_order_relaxed);
+            while (value > current && !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+        }
+
+        void mergeInto(MetricHistogram& out) const {
+            bool any = false;
+            for (size_t i = 0; i < MetricHistogram::kBucketCount; ++i) {
+                uint64_t n = counts_[i].load(std::memory_order_relaxed);
+                if (n == 0) continue;
+                out.addBucket(i, n);
+                any = true;
+            }
+            if (any) {
+                out.addSummary(sum_.load(std::memory_order_relaxed), min_.load(std::memory_order_relaxed),
+                               max_.load(std::memory_order_relaxed));
+            }
+        }
+
+    private:
+        std::atomic<uint64_t> counts_[MetricHistogram::kBucketCount];
+        std::atomic<uint64_t> sum_;
+        std::atomic<uint64_t> min_;
+        std::atomic<uint64_t> max_;
+};
+
+struct MethodMetricsSnapshot {
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+    MetricHistogram queue_wait_ns;      // 从交给线程池到开始执行
+    MetricHistogram execution_ns;       // 服务方法本身的执行时间
+    MetricHistogram response_bytes;
+};
+
+class MethodMetrics {
+    public:
+        MethodMetrics() {
+            for (auto& shard : shards_) shard.store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~MethodMetrics() {
+            for (auto& shard : shards_) delete shard.load(std::memory_order_relaxed);
+        }
+
+        MethodMetrics(const MethodMetrics&) = delete;
+        MethodMetrics& operator=(const MethodMetrics&) = delete;
+
+        // 一次请求结束：ok为false表示返回了错误
+        void recordRequest(bool ok, uint64_t response_bytes) {
+            Shard& s = shard();
+            s.requests.fetch_add(1, std::memory_order_relaxed);
+            if (!ok) s.errors.fetch_add(1, std::memory_order_relaxed);
+            s.response_bytes.record(response_bytes);
+        }
+
+        void recordCache(bool hit) {
+            (hit ? shard().cache_hits : shard().cache_misses).fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void recordQueueWait(uint64_t ns) { shard().queue_wait_ns.record(ns); }
+        void recordExecution(uint64_t ns) { shard().execution_ns.record(ns); }
+
+        MethodMetricsSnapshot snapshot() const {
+            MethodMetricsSnapshot out;
+            for (const auto& slot : shards_) {
+                const Shard* s = slot.load(std::memory_order_acquire);
+                if (!s) continue;
+                out.requests += s->requests.load(std::memory_order_relaxed);
+                out.errors += s->errors.load(std::memory_order_relaxed);
+                out.cache_hits += s->cache_hits.load(std::memory_order_relaxed);
+                out.cache_misses += s->cache_misses.load(std::memory_order_relaxed);
+                s->queue_wait_ns.mergeInto(out.queue_wait_ns);
+                s->execution_ns.mergeInto(out.execution_ns);
+                s->response_bytes.mergeInto(out.response_bytes);
+            }
+            return out;
+        }
+
+    private:
+        // 按缓存行对齐，不同线程的分片不会伪共享
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> requests{0};
+            std::atomic<uint64_t> errors{0};
+            std::atomic<uint64_t> cache_hits{0};
+            std::atomic<uint64_t> cache_misses{0};
+            AtomicHistogram queue_wait_ns;
+            AtomicHistogram execution_ns;
+            AtomicHistogram response_bytes;
+        };
+
+        // 分片在线程第一次写入时分配，两个线程同时分配时只保留一个
+        Shard& shard() {
+            std::atomic<Shard*>& slot = shards_[metricShardIndex()];
+            Shard* s = slot.load(std::memory_order_acquire);
+            if (s) return *s;
+            Shard* fresh = new Shard();
+            if (slot.compare_exchange_strong(s, fresh, std::memory_order_acq_rel)) return *fresh;
+            delete fresh;
+            return *s;
+        }
+
+        std::atomic<Shard*> shards_[kMetricShards];
+};
+
+// 分位数统一输出这几个
+constexpr double kReportedPercentiles[] = {50, 90, 99, 99.9};
+
+// scale把内部单位换算为输出单位，如纳秒换算为微秒
+inline nlohmann::json histogramToJson(const MetricHistogram& h, double scale) {
+    return {
+        {"count", h.count()}, {"mean", h.mean() * scale},
+        {"p50", h.valueAtPercentile(50) * scale}, {"p90", h.valueAtPercentile(90) * scale},
+        {"p99", h.valueAtPercentile(99) * scale}, {"p999", h.valueAtPercentile(99.9) * scale},
+        {"max", h.max() * scale}
+    };
+}
+
+// Prometheus标签值需要转义反斜杠、双引号和换行
+inline std::string prometheusEscape(const std::string& value) {
+    std::string out;
+    for (char c : value) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    return out;
+}
+
+inline void appendPrometheusValue(std::string& out, const std::string& name, const std::string& labels,
+                                  double value) {
+    char number[32];
+    snprintf(number, sizeof(number), "%.12g", value);
+    out += name;
+    if (!labels.empty()) out += "{" + labels + "}";
+    out += " ";
+    out += number;
+    out += "\n";
+}
+
+// 以summary类型输出：各分位数、_sum和_count
+inline void appendPrometheusSummary(std::string& out, const std::string& name, const std::string& labels,
+                                    const MetricHistogram& h, double scale) {
+    for (double percentile : kReportedPercentiles) {
+        char quantile[48];
+        snprintf(quantile, sizeof(quantile), "quantile=\"%g\"", percentile / 100);
+        appendPrometheusValue(out, name, labels + "," + quantile, h.valueAtPercentile(percentile) * scale);
+    }
+    appendPrometheusValue(out, name + "_sum", labels, h.sum() * scale);
+    appendPrometheusValue(out, name + "_count", labels, static_cast<double>(h.count()));
+}
+
+} // namespace trpc
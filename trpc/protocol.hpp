@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <arpa/inet.h>
+
+#include "iobuf.hpp"
+
+/*
+    传输帧
+    +帧格式 ： | magic(4B) | meta长度(4B) | payload长度(4B) | meta | 填充 | payload |，长度均为网络字节序
+    +meta为JSON消息；payload为可选的二进制数据(如矩阵)，按本机字节序紧密存放
+    +meta之后填充0到8字节对齐，payload在帧内的偏移是8的倍数，接收端可以直接在缓冲区上按类型访问
+    +TCP是字节流，一次read可能只读到半个请求，也可能读到多个请求，需要按帧切分
+*/
+namespace trpc {
+
+constexpr uint32_t kFrameMagic = 0x74525043;      // "tRPC"
+constexpr size_t kFrameHeaderSize = 12;
+constexpr size_t kDefaultMaxFrameSize = 64 * 1024 * 1024;
+constexpr size_t kPayloadAlignment = 8;
+
+struct Frame {
+    std::string meta;
+    std::string payload;
+};
+
+// payload在帧内的起始偏移
+inline size_t framePayloadOffset(size_t meta_size) {
+    size_t end = kFrameHeaderSize + meta_size;
+    return (end + kPayloadAlignment - 1) / kPayloadAlignment * kPayloadAlignment;
+}
+
+// 写入kFrameHeaderSize字节的帧头
+inline void writeFrameHeader(char* out, size_t meta_size, size_t payload_size) {
+    uint32_t header[3] = {
+        htonl(kFrameMagic),
+        htonl(static_cast<uint32_t>(meta_size)),
+        htonl(static_cast<uint32_t>(payload_size))
+    };
+    memcpy(out, header, kFrameHeaderSize);
+}
+
+// 编码到frame中，frame原有的容量足够时不重新分配
+inline void encodeFrameTo(std::string& frame, const std::string& meta, const std::string& payload) {
+    size_t payload_offset = framePayloadOffset(meta.size());
+    frame.assign(payload_offset + payload.size(), '\0');
+    writeFrameHeader(&frame[0], meta.size(), payload.size());
+    memcpy(&frame[kFrameHeaderSize], meta.data(), meta.size());
+    memcpy(&frame[payload_offset], payload.data(), payload.size());
+}
+
+// 以下两个函数配合使用，把帧追加到IOBuf：帧头，调用方追加的meta，meta之后的填充，调用方追加的payload
+inline void appendFrameHeader(IOBuf& frame, size_t meta_size, size_t payload_size) {
+    char header[kFrameHeaderSize];
+    writeFrameHeader(header, meta_size, payload_size);
+    frame.append(header, kFrameHeaderSize);
+}
+
+inline void appendFramePadding(IOBuf& frame, size_t meta_size) {
+    static const char kZeros[kPayloadAlignment] = {};
+    frame.append(kZeros, framePayloadOffset(meta_size) - kFrameHeaderSize - meta_size);
+}
+
+// 编码到IOBuf：帧头和较小的meta、payload拷贝进池化块，较大的直接接管，发送时不再拼接
+inline void encodeFrameTo(IOBuf& frame, std::string&& meta, std::string&& payload) {
+    size_t meta_size = meta.size();
+    appendFrameHeader(frame, meta_size, payload.size());
+    frame.append(std::move(meta));
+    appendFramePadding(frame, meta_size);
+    frame.append(std::move(payload));
+}
+
+inline std::string encodeFrame(const std::string& meta, const std::string& payload = std::string()) {
+    std::string frame;
+    encodeFrameTo(frame, meta, payload);
+    return frame;
+}
+
+// 解析帧头得到meta和payload的长度；magic不符或总长度超限时抛出异常
+inline void decodeFrameHeader(const char* header, size_t& meta_size, size_t& payload_size,
+                              size_t max_frame_size = kDefaultMaxFrameSize) {
+    uint32_t fields[3];
+    memcpy(fields, header, kFrameHeaderSize);
+    if (ntohl(fields[0]) != kFrameMagic) {
+        throw std::runtime_error("Bad frame magic");
+    }
+    meta_size = ntohl(fields[1]);
+    payload_size = ntohl(fields[2]);
+    if (meta_size + payload_size > max_frame_size) {
+        throw std::runtime_error("Frame too large");
+    }
+}
+
+// 从buffer的offset处切出一个完整帧并把offset移到帧尾；数据不足一帧时返回false，offset不变。
+// 已取出的数据由调用方在下次追加前一次性清除，逐帧erase会使流水线输入的处理变成平方复杂度
+inline bool extractFrame(const std::string& buffer, size_t& offset, Frame& frame,
+                         size_t max_frame_size = kDefaultMaxFrameSize) {
+    if (buffer.size() - offset < kFrameHeaderSize) return false;
+    size_t meta_size, payload_size;
+    decodeFrameHeader(buffer.data() + offset, meta_size, payload_size, max_frame_size);
+    size_t payload_offset = framePayloadOffset(meta_size);
+    size_t total = payload_offset + payload_size;
+    if (buffer.size() - offset < total) return false;
+    frame.meta.assign(buffer, offset + kFrameHeaderSize, meta_size);
+    frame.payload.assign(buffer, offset + payload_offset, payload_size);
+    offset += total;
+    return true;
+}
+
+// 与extractFrame相同，但整帧(含帧头)原样取出，meta和payload以偏移表示；
+// buffer中恰好是一帧时与frame交换内存，不拷贝，frame原有的缓冲区留给buffer继续接收。
+// 全部数据都已取出时直接清空buffer，offset归零
+inline bool takeFrame(std::string& buffer, size_t& offset, std::string& frame, size_t& meta_size,
+                      size_t& payload_size, size_t max_frame_size = kDefaultMaxFrameSize) {
+    if (buffer.size() - offset < kFrameHeaderSize) return false;
+    decodeFrameHeader(buffer.data() + offset, meta_size, payload_size, max_frame_size);
+    size_t total = framePayloadOffset(meta_size) + payload_size;
+    if (buffer.size() - offset < total) return false;
+    if (offset == 0 && buffer.size() == total) {
+        frame.swap(buffer);
+        buffer.clear();
+        return true;
+    }
+    frame.assign(buffer, offset, total);
+    offset += total;
+    if (offset == buffer.size()) {
+        buffer.clear();
+        offset = 0;
+    }
+    return true;
+}
+
+} // namespace trpc
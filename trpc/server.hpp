@@ -6,6 +6,7 @@
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <thread>
@@ -13,35 +14,76 @@
 #include <mutex>
 #include <condition_variable>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <unordered_map>
+#include <list>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <tuple>
+#include <charconv>
+#include <limits>
 #include <hiredis/hiredis.h>
 
 #include "json.hpp"
 #include "service.hpp"
+#include "timer.hpp"
+#include "protocol.hpp"
+#include "threadpool.hpp"
+#include "dag.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include "logger.hpp"
+#include "status.hpp"
+#include "arena.hpp"
+#include "iobuf.hpp"
 
 namespace trpc {
 
 /*
     事件驱动模型
-    +Reactor ： 处理IO事件
+    +Reactor ： 处理IO事件和定时器，接收其他线程投递的任务
     +ThreadPool ： 处理任务
     +Server ： 综合功能，提供面向外界的服务代理
 */
 class Reactor {
     public:
-        Reactor() : epoll_fd_(-1) {
+        Reactor() : epoll_fd_(-1), wakeup_fd_(-1), running_(false), posted_(nullptr) {
             epoll_fd_ = epoll_create1(0);
             if (epoll_fd_ == -1) {
                 throw std::runtime_error("Failed to create epoll instance");
             }
+
+            wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (wakeup_fd_ == -1) {
+                close(epoll_fd_);
+                throw std::runtime_error("Failed to create eventfd");
+            }
+
+            // 所有定时器共用一个timerfd
+            addFd(timers_.getFd(), EPOLLIN);
+            addFd(wakeup_fd_, EPOLLIN);
         }
         
         ~Reactor() {
+            TaskNode* node = posted_.exchange(nullptr, std::memory_order_acquire);
+            while (node) {
+                TaskNode* next = node->next;
+                delete node;
+                node = next;
+            }
+            if (wakeup_fd_ != -1) {
+                close(wakeup_fd_);
+            }
             if (epoll_fd_ != -1) {
                 close(epoll_fd_);
             }
@@ -74,73 +116,105 @@ class Reactor {
         void run(std::function<void(int)> callback) {
             const int MAX_EVENTS = 64;
             struct epoll_event events[MAX_EVENTS];
-            
-            while (true) {
+
+            loop_thread_ = std::this_thread::get_id();
+            running_ = true;
+            while (running_) {
                 int nfds = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
                 if (nfds == -1) {
+                    if (errno == EINTR) continue;
                     throw std::runtime_error("epoll_wait failed");
                 }
 
                 for (int i = 0; i < nfds; ++i) {
-                    callback(events[i].data.fd);
+                    int fd = events[i].data.fd;
+                    if (fd == timers_.getFd()) {
+                        timers_.handleExpired();
+                    } else if (fd == wakeup_fd_) {
+                        runPosted();
+                    } else {
+                        callback(fd);
+                    }
                 }
             }
         }
-        
-    private:
-        int epoll_fd_;
-};
 
-class ThreadPool {
-    public:
-        ThreadPool(int numThreads) : stop_(false) {
-            for (int i = 0; i < numThreads; ++i) {
-                threads_.emplace_back([this] {
-                    while (true) {
-                        std::function<void()> task;
-                        {
-                            std::unique_lock<std::mutex> lock(mutex_);
-                            condition_.wait(lock, [this] {
-                                return stop_ || !tasks_.empty();
-                            });
-                            if (stop_ && tasks_.empty()) return;
-                            task = std::move(tasks_.front());
-                            tasks_.pop();
-                        }
-                        task();
-                    }
-                });
-            }
+        // 可在任意线程调用：事件循环在处理完当前这批事件后退出
+        void stop() {
+            post([this]() { running_ = false; });
         }
 
-        ~ThreadPool() {
-            {
-                std::unique_lock<std::mutex> lock(mutex_);
-                stop_ = true;
-            }
-            condition_.notify_all();
-            for (auto& thread : threads_) {
-                thread.join();
+        // 可在任意线程调用：把任务投递到事件循环线程执行，按投递顺序执行
+        void post(std::function<void()> task) {
+            TaskNode* node = new TaskNode{std::move(task), nullptr};
+            TaskNode* head = posted_.load(std::memory_order_relaxed);
+            do {
+                node->next = head;
+            } while (!posted_.compare_exchange_weak(head, node,
+                                                    std::memory_order_release,
+                                                    std::memory_order_relaxed));
+            // 只有把队列从空变为非空的生产者才写eventfd，一次唤醒处理整批任务
+            if (head == nullptr) {
+                uint64_t one = 1;
+                ssize_t n = write(wakeup_fd_, &one, sizeof(one));
+                (void)n;
             }
         }
 
-        void addTask(std::function<void()> task) {
-            {
-                std::unique_lock<std::mutex> lock(mutex_);
-                if (stop_) {
-                    throw std::runtime_error("ThreadPool is stopped");
-                }
-                tasks_.emplace(std::move(task));
-            }
-            condition_.notify_one();
+        bool isInLoopThread() const {
+            return loop_thread_ == std::this_thread::get_id();
+        }
+
+        // 定时器接口只能在事件循环线程中调用
+        TimerId runAfter(std::chrono::milliseconds delay, std::function<void()> callback) {
+            return timers_.runAfter(delay, std::move(callback));
+        }
+
+        TimerId runEvery(std::chrono::milliseconds interval, std::function<void()> callback) {
+            return timers_.runEvery(interval, std::move(callback));
+        }
+
+        bool cancelTimer(TimerId id) {
+            return timers_.cancel(id);
         }
         
     private:
-        std::vector<std::thread> threads_;
-        std::queue<std::function<void()>> tasks_;
-        std::mutex mutex_;
-        std::condition_variable condition_;
-        bool stop_;
+        // 无锁MPSC队列：生产者压栈，事件循环整体取走后反转为FIFO
+        struct TaskNode {
+            std::function<void()> task;
+            TaskNode* next;
+        };
+
+        void runPosted() {
+            uint64_t count;
+            while (read(wakeup_fd_, &count, sizeof(count)) > 0) {}
+
+            TaskNode* node = posted_.exchange(nullptr, std::memory_order_acquire);
+            TaskNode* ordered = nullptr;
+            while (node) {
+                TaskNode* next = node->next;
+                node->next = ordered;
+                ordered = node;
+                node = next;
+            }
+
+            while (ordered) {
+                std::unique_ptr<TaskNode> current(ordered);
+                ordered = ordered->next;
+                try {
+                    current->task();
+                } catch (const std::exception& e) {
+                    TRPC_LOG(LogLevel::Error, "Error in posted task: {}", e.what());
+                }
+            }
+        }
+
+        int epoll_fd_;
+        int wakeup_fd_;
+        bool running_;
+        std::thread::id loop_thread_;
+        std::atomic<TaskNode*> posted_;
+        TimerQueue timers_;
 };
 
 class ServerCore {
@@ -171,15 +245,47 @@ class ServerCore {
             }
         }
 
+        // 监听Unix域socket，同一台机器上的客户端不经过TCP/IP协议栈；
+        // 路径上残留的socket文件(上次没有正常退出)先删除
+        explicit ServerCore(const std::string& unix_path) : port_(0), unix_path_(unix_path) {
+            struct sockaddr_un addr = {};
+            if (unix_path.empty() || unix_path.size() >= sizeof(addr.sun_path)) {
+                throw std::invalid_argument("Invalid unix socket path: " + unix_path);
+            }
+            listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            if (listen_fd_ == -1) {
+                throw std::runtime_error("Failed to create socket");
+            }
+
+            struct stat st;
+            if (stat(unix_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+                unlink(unix_path.c_str());
+            }
+            addr.sun_family = AF_UNIX;
+            memcpy(addr.sun_path, unix_path.data(), unix_path.size());
+            if (bind(listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+                close(listen_fd_);
+                throw std::runtime_error("Failed to bind unix socket: " + unix_path);
+            }
+            if (listen(listen_fd_, SOMAXCONN) == -1) {
+                close(listen_fd_);
+                throw std::runtime_error("Failed to listen on socket");
+            }
+        }
+
         ~ServerCore() {
             close(listen_fd_);
+            if (!unix_path_.empty()) {
+                unlink(unix_path_.c_str());
+            }
         }
 
         int getListenFd() const { return listen_fd_; }
         int getPort() const { return port_; }
+        const std::string& getUnixPath() const { return unix_path_; }
 
         int acceptConnection() {
-            struct sockaddr_in client_addr;
+            struct sockaddr_storage client_addr;
             socklen_t client_len = sizeof(client_addr);
             int client_fd = accept(listen_fd_, (struct sockaddr*)&client_addr, &client_len);
             
@@ -197,40 +303,116 @@ class ServerCore {
             return client_fd;
         }
 
-        std::string readData(int fd) {
-            char buffer[1024];
-            std::string message;
+        // 读取当前所有可读数据并追加到buffer，对端关闭连接时返回false。
+        // buffer达到max_size即停止，余下的数据留在socket中，重新布防读事件后会再次触发
+        bool readData(int fd, std::string& buffer, size_t max_size = std::numeric_limits<size_t>::max()) {
+            char chunk[16384];
             
-            while (true) {
-                ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
+            while (buffer.size() < max_size) {
+                ssize_t bytes_read = read(fd, chunk, std::min(sizeof(chunk), max_size - buffer.size()));
                 if (bytes_read == -1) {
+                    if (errno == EINTR) continue;
                     if (errno == EAGAIN || errno == EWOULDBLOCK) {
                         break;
                     }
                     throw std::runtime_error("Failed to read from socket");
                 } else if (bytes_read == 0) {
                     // 客户端关闭连接
-                    return "";
+                    return false;
                 }
                 
-                message.append(buffer, bytes_read);
+                buffer.append(chunk, bytes_read);
             }
 
-            return message;
+            return true;
         }
 
     private:
         int port_;
+        std::string unix_path_;     // 监听TCP端口时为空
         int listen_fd_;
 };
 
+// 缓存键为"服务:方法:请求原文"，拼接在请求的arena中，随请求一起回收
+inline std::string_view makeCacheKey(Arena& arena, std::string_view service_name, std::string_view method_name,
+                                     std::string_view raw) {
+    return arena.concat({service_name, ":", method_name, ":", raw});
+}
+
+// 连接数超过上限时对新连接的处理策略
+enum class OverloadPolicy {
+    Reject,             // 直接关闭新连接
+    CloseOldestIdle     // 关闭最久未活动的连接，为新连接腾出位置
+};
+
+// 方法的执行位置
+enum class ExecutionMode {
+    Pool,       // 总是交给线程池
+    Inline,     // 总在事件循环线程执行，不经过Redis缓存
+    Adaptive    // 开销固定的方法根据测得的平均执行耗时在两者间切换，其余总是交给线程池
+};
+
+struct ServerOptions {
+    size_t max_connections = 10000;
+    OverloadPolicy overload_policy = OverloadPolicy::Reject;
+    // 连接空闲或响应发送停滞超过该时长即被回收，0表示不回收
+    std::chrono::milliseconds idle_timeout = std::chrono::seconds(60);
+    // 未单独设置的方法使用的执行位置
+    ExecutionMode default_execution_mode = ExecutionMode::Adaptive;
+    // 自适应模式下平均耗时低于该值的方法改为内联执行，高于两倍时退回线程池
+    std::chrono::nanoseconds inline_threshold = std::chrono::microseconds(5);
+    // 单个请求帧的最大长度，超过即视为非法连接
+    size_t max_frame_size = kDefaultMaxFrameSize;
+    // 一个批量请求最多包含的调用数
+    size_t max_batch_size = 4096;
+    // 管理端口，GET /metrics返回Prometheus文本格式的指标；0表示不开启
+    int admin_port = 0;
+    // 按该比例抽样记录请求各阶段的耗时，0表示只记录带"trace": true的请求
+    double trace_sample_rate = 0.01;
+    // 不小于该字节数的响应用MSG_ZEROCOPY发送，0表示不使用。回环上接收端仍要拷贝，没有收益；
+    // 跨机器时按zerocopy_bench的方法测出发送端CPU的交叉点再设置
+    size_t zerocopy_threshold = 0;
+    // 不为空时同时在该路径监听Unix域socket，帧格式和处理流程与TCP连接相同
+    std::string unix_path;
+};
+
+// 跨请求合并：同一方法的多个标量请求凑成一批，用一次SIMD批量运算完成
+struct BatchingOptions {
+    size_t max_batch_size = 256;
+    // 第一个请求到达后最多等待的时间；0表示只合并同一轮事件循环中到达的请求。定时器精度为1ms
+    std::chrono::milliseconds max_wait = std::chrono::milliseconds(0);
+};
+
+struct ServerStats {
+    uint64_t accepted;      // 成功接入的连接数
+    uint64_t rejected;      // 因超过上限被拒绝的连接数
+    uint64_t reaped;        // 因空闲或发送停滞超时被回收的连接数
+    uint64_t evicted;       // 为新连接让位而被关闭的空闲连接数
+    uint64_t active;        // 当前连接数
+    uint64_t batches;       // 跨请求合并执行的批次数
+    uint64_t batched;       // 其中包含的请求数
+    uint64_t zerocopy;      // 以MSG_ZEROCOPY发送的响应数
+    uint64_t zerocopy_copied;   // 零拷贝发送中被内核退回拷贝的次数
+};
+
 class Server {
     public:
-        Server(int port) : port_(port), 
+        Server(int port, const ServerOptions& options = ServerOptions())
+                        : port_(port),
+                          options_(options),
                           server_core_(std::make_unique<ServerCore>(port)),
                           reactor_(std::make_unique<Reactor>()),
                           threadPool_(std::make_unique<ThreadPool>(4)),
-                          redis_context_(nullptr) {
+                          redis_context_(nullptr),
+                          trace_interval_(options.trace_sample_rate > 0
+                                          ? static_cast<uint64_t>(std::max(1.0, 1.0 / options.trace_sample_rate + 0.5))
+                                          : 0) {
+            if (options_.admin_port > 0) {
+                admin_core_ = std::make_unique<ServerCore>(options_.admin_port);
+            }
+            if (!options_.unix_path.empty()) {
+                unix_core_ = std::make_unique<ServerCore>(options_.unix_path);
+            }
             // 初始化Redis连接
             redis_context_ = redisConnect("127.0.0.1", 6379);
             if (redis_context_ == nullptr || redis_context_->err) {
@@ -239,119 +421,1415 @@ class Server {
             
             // 将监听socket添加到epoll
             reactor_->addFd(server_core_->getListenFd(), EPOLLIN | EPOLLET);
+            if (admin_core_) {
+                reactor_->addFd(admin_core_->getListenFd(), EPOLLIN | EPOLLET);
+            }
+            if (unix_core_) {
+                reactor_->addFd(unix_core_->getListenFd(), EPOLLIN | EPOLLET);
+            }
         }
 
         ~Server() {
+            // stop()之后线程池中可能还有任务在执行，它们要用Redis连接、服务和方法指标，
+            // 先让线程池退出再释放；成员按声明逆序析构，等不到这些成员之后
+            threadPool_.reset();
             if (redis_context_) {
                 redisFree(redis_context_);
             }
         }
 
         void registerService(const std::string& name, std::unique_ptr<BaseService> service) {
+            service->setThreadPool(threadPool_.get());
             registry_.registerService(name, std::move(service));
         }
 
+        // 指定某个方法的执行位置，需在start()之前调用
+        void setExecutionMode(const std::string& service_name, const std::string& method_name,
+                              ExecutionMode mode) {
+            getProfile(service_name, method_name)->mode = mode;
+        }
+
+        // 为计算服务的标量方法(add/sub/mul/div)开启跨请求合并，需在start()之前调用；
+        // 合并执行的请求不经过Redis缓存
+        void enableBatching(const std::string& service_name, const std::string& method_name,
+                            const BatchingOptions& batching = BatchingOptions()) {
+            if (method_name != "add" && method_name != "sub" && method_name != "mul" && method_name != "div") {
+                throw std::invalid_argument("Method cannot be batched: " + method_name);
+            }
+            if (batching.max_batch_size == 0) {
+                throw std::invalid_argument("Batch size must be positive");
+            }
+            auto& batcher = batchers_[service_name + "." + method_name];
+            batcher = std::make_unique<MethodBatcher>();
+            batcher->options = batching;
+            getProfile(service_name, method_name)->batcher = batcher.get();
+        }
+
         void start() {
             reactor_->run([this](int fd) {
                 if (fd == server_core_->getListenFd()) {
-                    handleNewConnection();
+                    handleNewConnection(*server_core_);
+                } else if (unix_core_ && fd == unix_core_->getListenFd()) {
+                    handleNewConnection(*unix_core_);
+                } else if (admin_core_ && fd == admin_core_->getListenFd()) {
+                    handleNewAdminConnection();
+                } else if (admin_connections_.count(fd)) {
+                    handleAdminData(fd);
                 } else {
                     handleClientData(fd);
                 }
             });
         }
 
+        // 可在任意线程调用，使start()返回
+        void stop() {
+            reactor_->stop();
+        }
+
+        ServerStats getStats() const {
+            return ServerStats{
+                accepted_.load(std::memory_order_relaxed),
+                rejected_.load(std::memory_order_relaxed),
+                reaped_.load(std::memory_order_relaxed),
+                evicted_.load(std::memory_order_relaxed),
+                active_.load(std::memory_order_relaxed),
+                batches_.load(std::memory_order_relaxed),
+                batched_.load(std::memory_order_relaxed),
+                zerocopy_.load(std::memory_order_relaxed),
+                zerocopy_copied_.load(std::memory_order_relaxed)
+            };
+        }
+
+        // 内置服务名，{"service_name": "_trpc", "method_name": "stats"}返回服务端指标
+        static constexpr const char* kBuiltinService = "_trpc";
+
     private:
-        void handleNewConnection() {
+        // 连接的处理阶段：同一时刻只有一个阶段持有连接
+        enum class ConnState {
+            Reading,        // 等待请求，epoll监听可读
+            Processing,     // 请求在线程池中处理，epoll不再通知该连接
+            Writing         // 响应未写完，epoll监听可写
+        };
+
+        // 连接句柄：fd会被内核复用，需要同时比较代数才能确认是同一个连接
+        struct ConnHandle {
+            int fd;
+            uint32_t generation;
+        };
+
+        // 连接状态只在事件循环线程中访问
+        struct Connection {
+            uint32_t generation = 0;
+            ConnState state = ConnState::Reading;
+            std::chrono::steady_clock::time_point last_active;
+            std::list<int>::iterator lru_pos;   // 空闲时在idle_lru_中，处理中在busy_中
+            TimerId idle_timer = kInvalidTimerId;
+            std::string input;                  // 已读取但还未处理的数据
+            size_t input_offset = 0;            // input中已取出的字节数，下次读取前一次性清除
+            IOBuf output;                       // 未写完的响应，按片段发送，已发送的部分随即释放
+            uint64_t read_ns = 0;               // 最近一次读取的耗时
+            RequestTrace trace;                 // 正在发送的响应的计时，发送完毕后计入汇总
+            bool zerocopy_capable = false;      // 开启了SO_ZEROCOPY
+            bool zerocopy = false;              // 正在发送的响应走MSG_ZEROCOPY
+            ZeroCopyTracker zerocopy_sent;      // 已零拷贝发送、等待内核完成通知的数据
+            bool dispatching = false;           // processInput正在循环处理已缓冲的帧
+            int unsent = 0;                     // 上次发送停滞时内核发送队列中的字节数
+
+            // 归还连接池时清空状态，不大的缓冲区留给下一个连接
+            void reset() {
+                state = ConnState::Reading;
+                idle_timer = kInvalidTimerId;
+                resetBuffer(input);
+                input_offset = 0;
+                output.clear();
+                read_ns = 0;
+                trace = RequestTrace();
+                zerocopy_capable = zerocopy = false;
+                zerocopy_sent.reset();
+                dispatching = false;
+                unsent = 0;
+            }
+        };
+
+        // 管理端口上的HTTP连接：读到完整请求头后回复一次即关闭
+        struct AdminConnection {
+            std::string input;
+            std::string output;
+            size_t output_offset = 0;
+        };
+
+        struct Request;
+
+        // 使用EPOLLONESHOT，每次事件之后必须显式重新布防
+        static constexpr uint32_t kReadEvents = EPOLLIN | EPOLLET | EPOLLONESHOT;
+        static constexpr uint32_t kWriteEvents = EPOLLOUT | EPOLLET | EPOLLONESHOT;
+
+        // TCP和Unix域socket的连接接入后完全相同
+        void handleNewConnection(ServerCore& core) {
             while (true) {
-                int client_fd = server_core_->acceptConnection();
+                int client_fd = core.acceptConnection();
                 if (client_fd == -1) break;
+
+                if (connection_count_ >= options_.max_connections && !makeRoom()) {
+                    close(client_fd);
+                    rejected_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
                 
                 // 将新连接添加到epoll
-                reactor_->addFd(client_fd, EPOLLIN | EPOLLET);
+                reactor_->addFd(client_fd, kReadEvents);
+
+                // 连接对象来自连接池，按fd直接索引
+                if (static_cast<size_t>(client_fd) >= connections_.size()) {
+                    connections_.resize(client_fd + 1, nullptr);
+                }
+                Connection& conn = *(connections_[client_fd] = connection_pool_.acquire());
+                ++connection_count_;
+                conn.generation = ++next_generation_;
+                conn.last_active = std::chrono::steady_clock::now();
+                conn.lru_pos = takeLruNode(client_fd);
+                conn.zerocopy_capable = options_.zerocopy_threshold != 0 && ZeroCopyTracker::enable(client_fd);
+                armIdleTimer(client_fd, options_.idle_timeout);
+                accepted_.fetch_add(1, std::memory_order_relaxed);
+                active_.store(connection_count_, std::memory_order_relaxed);
+            }
+        }
+
+        // 链表节点在idle_lru_、busy_和spare_lru_之间splice，连接的建立和请求处理都不再分配节点
+        std::list<int>::iterator takeLruNode(int fd) {
+            if (spare_lru_.empty()) return idle_lru_.insert(idle_lru_.end(), fd);
+            auto node = spare_lru_.begin();
+            *node = fd;
+            idle_lru_.splice(idle_lru_.end(), spare_lru_, node);
+            return node;
+        }
+
+        // 按策略为新连接腾出位置，成功返回true
+        bool makeRoom() {
+            if (options_.overload_policy != OverloadPolicy::CloseOldestIdle || idle_lru_.empty()) {
+                return false;
             }
+            closeConnection(idle_lru_.front());
+            evicted_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        void armIdleTimer(int fd, std::chrono::milliseconds delay) {
+            if (options_.idle_timeout.count() <= 0) return;
+            findConnection(fd)->idle_timer = reactor_->runAfter(delay, [this, fd]() {
+                onIdleTimer(fd);
+            });
+        }
+
+        // 定时器不随每次读写重置，到期时再根据最后活动时间决定回收或顺延；
+        // 发送中的连接按最后一次发送进展计算，对端一直不读响应时同样回收
+        void onIdleTimer(int fd) {
+            Connection* conn = findConnection(fd);
+            if (!conn) return;
+            conn->idle_timer = kInvalidTimerId;
+
+            auto now = std::chrono::steady_clock::now();
+            if (conn->state == ConnState::Writing && now - conn->last_active >= options_.idle_timeout) {
+                // 发送缓冲区满后要腾出较大空间才会再次可写，对端读得慢时间隔可能超过空闲超时；
+                // 内核发送队列在缩短同样说明对端还在读
+                int unsent = unsentBytes(fd);
+                if (unsent >= 0 && unsent < conn->unsent) conn->last_active = now;
+                conn->unsent = unsent;
+            }
+            auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(now - conn->last_active);
+            if (conn->state == ConnState::Processing || idle < options_.idle_timeout) {
+                // 正在处理的连接不算空闲
+                armIdleTimer(fd, conn->state == ConnState::Processing
+                                 ? options_.idle_timeout : options_.idle_timeout - idle);
+                return;
+            }
+            closeConnection(fd);
+            reaped_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // 内核发送队列中还未被对端确认的字节数，查询失败时返回-1
+        static int unsentBytes(int fd) {
+            int unsent = 0;
+            return ioctl(fd, SIOCOUTQ, &unsent) == 0 ? unsent : -1;
+        }
+
+        void closeConnection(int fd) {
+            bool draining = false;
+            if (Connection* conn = findConnection(fd)) {
+                reactor_->cancelTimer(conn->idle_timer);
+                std::list<int>& owner = conn->state == ConnState::Reading ? idle_lru_ : busy_;
+                spare_lru_.splice(spare_lru_.end(), owner, conn->lru_pos);
+                if (!conn->zerocopy_sent.idle()) reapZeroCopy(fd, *conn);
+                if (!conn->zerocopy_sent.idle()) {
+                    // 内核可能还在读取零拷贝发送的片段，它们要保留到完成通知到达，
+                    // 通知只能从这个socket读取，所以fd也暂不关闭
+                    draining_.emplace(fd, std::move(conn->zerocopy_sent));
+                    draining = true;
+                }
+                connection_pool_.release(conn);
+                connections_[fd] = nullptr;
+                --connection_count_;
+                active_.store(connection_count_, std::memory_order_relaxed);
+            }
+            if (draining) {
+                // 不再收发，已排队的数据发完后发出FIN；之后只关心错误队列，EPOLLERR总会上报
+                shutdown(fd, SHUT_RDWR);
+                reactor_->modifyFd(fd, EPOLLET);
+                return;
+            }
+            reactor_->removeFd(fd);
+            close(fd);
+        }
+
+        // 已关闭的连接收齐零拷贝完成通知后才真正关闭fd，期间fd不会被新连接复用
+        void drainZeroCopy(int fd) {
+            auto it = draining_.find(fd);
+            if (it == draining_.end()) return;
+            uint32_t copied = it->second.reap(fd);
+            if (copied) zerocopy_copied_.fetch_add(copied, std::memory_order_relaxed);
+            if (!it->second.idle()) return;
+            draining_.erase(it);
+            reactor_->removeFd(fd);
+            close(fd);
+        }
+
+        void reapZeroCopy(int fd, Connection& conn) {
+            uint32_t copied = conn.zerocopy_sent.reap(fd);
+            if (copied) zerocopy_copied_.fetch_add(copied, std::memory_order_relaxed);
+        }
+
+        Connection* findConnection(int fd) {
+            return fd >= 0 && static_cast<size_t>(fd) < connections_.size() ? connections_[fd] : nullptr;
         }
 
         void handleClientData(int fd) {
-            std::string message = server_core_->readData(fd);
-            if (message.empty()) {
-                reactor_->removeFd(fd);
-                close(fd);
+            Connection* found = findConnection(fd);
+            if (!found) {
+                drainZeroCopy(fd);
                 return;
             }
+            Connection& conn = *found;
+            // 零拷贝的完成通知在错误队列中，以EPOLLERR唤醒
+            if (!conn.zerocopy_sent.idle()) reapZeroCopy(fd, conn);
+            if (conn.state == ConnState::Writing) {
+                flushOutput(fd, conn);
+                return;
+            }
+            if (conn.state != ConnState::Reading) return;
 
-            // 将消息放入线程池处理
-            threadPool_->addTask([this, fd, message]() {
-                try {
-                    auto json_msg = nlohmann::json::parse(message);
-                    std::string service_name = json_msg["service_name"];
-                    std::string method_name = json_msg["method_name"];
-                    auto args = json_msg["args"].get<std::vector<int>>();
-
-                    // 生成缓存键
-                    std::string cache_key = service_name + ":" + method_name + ":" + message;
-
-                    // 尝试从缓存获取结果
-                    redisReply* reply = (redisReply*)redisCommand(redis_context_, "GET %s", cache_key.c_str());
-                    if (reply && reply->type == REDIS_REPLY_STRING) {
-                        // 缓存命中，直接返回结果
-                        send(fd, reply->str, reply->len, 0);
-                        freeReplyObject(reply);
+            if (conn.input_offset) {
+                conn.input.erase(0, conn.input_offset);
+                conn.input_offset = 0;
+            }
+            bool open;
+            uint64_t read_begin = monotonicNanos();
+            try {
+                // 缓冲的输入不超过一个最大帧，流水线上更多的请求留在socket中，由对端的发送窗口限速
+                open = server_core_->readData(fd, conn.input,
+                                              kFrameHeaderSize + kPayloadAlignment + options_.max_frame_size);
+                conn.read_ns = monotonicNanos() - read_begin;
+            } catch (const std::exception&) {
+                // 连接异常(如被对端重置)只关闭该连接，不影响事件循环
+                open = false;
+            }
+            if (!open) {
+                closeConnection(fd);
+                return;
+            }
+            conn.last_active = std::chrono::steady_clock::now();
+            idle_lru_.splice(idle_lru_.end(), idle_lru_, conn.lru_pos);
+            processInput(fd, conn);
+        }
+
+        // 依次处理输入缓冲区中的完整请求，直到不足一帧或连接转入处理、发送状态。
+        // 内联执行的响应写完后连接回到读取状态，由这里的循环接着处理下一帧而不是递归，
+        // 流水线上积压的请求再多，栈深度也不变
+        void processInput(int fd, Connection& conn) {
+            conn.dispatching = true;
+            while (conn.state == ConnState::Reading && dispatchFrame(fd, conn)) {
+                // 发送响应出错时连接已关闭并归还连接池
+                if (findConnection(fd) != &conn) return;
+            }
+            conn.dispatching = false;
+        }
+
+        // 从输入缓冲区取出一个完整请求交给处理流程，不足一帧时重新布防读事件并返回false，
+        // 帧头非法而关闭连接时也返回false。
+        // 请求对象来自请求池，整帧交给请求持有直到响应发出，参数视图可以直接指向其中
+        bool dispatchFrame(int fd, Connection& conn) {
+            uint64_t decode_begin = monotonicNanos();
+            Request* request = request_pool_.acquire();
+            try {
+                size_t meta_size, payload_size;
+                if (!takeFrame(conn.input, conn.input_offset, request->buffer, meta_size, payload_size,
+                               options_.max_frame_size)) {
+                    request_pool_.release(request);
+                    reactor_->modifyFd(fd, kReadEvents);
+                    return false;
+                }
+                request->meta_offset = kFrameHeaderSize;
+                request->meta_size = meta_size;
+                request->payload_offset = framePayloadOffset(meta_size);
+                request->payload_size = payload_size;
+            } catch (const std::exception&) {
+                // 帧头非法，无法再找到下一个请求的边界
+                request_pool_.release(request);
+                closeConnection(fd);
+                return false;
+            }
+
+            // 交给线程池前移出LRU：处理中的连接既不会被回收，也不会再收到事件
+            conn.state = ConnState::Processing;
+            busy_.splice(busy_.end(), idle_lru_, conn.lru_pos);
+
+            // 格式错误、服务或方法不存在等客户端造成的错误以Status返回，不抛异常
+            request->handle = ConnHandle{fd, conn.generation};
+            if (request->meta_size != 0) {
+                request->json = nlohmann::json::parse(request->raw(), nullptr, false);
+                if (request->json.contains("batch")) {
+                    processBatch(request->handle, *request);
+                    request_pool_.release(request);
+                    return true;
+                }
+                Status status = readCallName(*request);
+                if (!status.ok()) {
+                    request->response.meta = errorResponse(status);
+                    respond(request);
+                    return true;
+                }
+                if (request->service_name == kBuiltinService) {
+                    request->response.meta = builtinResponse(request->method_name);
+                    respond(request);
+                    return true;
+                }
+            }
+            // IDL调用：meta为空，按payload开头的方法id分发，不解析JSON
+            Result<MethodProfile*> resolved = request->meta_size == 0 ? resolveIdlMethod(*request)
+                                                                      : resolveMethod(*request);
+            if (!resolved) {
+                request->response.meta = errorResponse(resolved.status());
+                respond(request);
+                return true;
+            }
+            MethodProfile* profile = resolved.value();
+            startTrace(*request, conn.read_ns, decode_begin);
+
+            if (profile->batcher) {
+                addToBatch(*profile, request);
+                return true;
+            }
+            if (profile->shouldInline()) {
+                // 廉价方法直接在事件循环线程执行，省去线程池的锁、唤醒和线程切换
+                invoke(*request, *profile, request->response);
+                request->trace.mark(Stage::Execute);
+                respond(request);
+                return true;
+            }
+
+            request->profile = profile;
+            request->queued = std::chrono::steady_clock::now();
+            // 只捕获两个指针，std::function可以就地存放，不为任务另外分配内存
+            threadPool_->addTask([this, request]() {
+                MethodProfile& profile = *request->profile;
+                profile.metrics.recordQueueWait(nanosSince(request->queued));
+                request->trace.mark(Stage::Queue);
+                processRequest(*request, profile, request->trace);
+                // 响应交回事件循环线程发送，工作线程不直接操作socket，请求也在那里归还
+                reactor_->post([this, request]() { respond(request); });
+            });
+            return true;
+        }
+
+        // 发送请求的响应并把请求归还请求池，只在事件循环线程调用
+        void respond(Request* request) {
+            onResponse(request->handle, std::move(request->response), request->trace, &request->cached);
+            request_pool_.release(request);
+        }
+
+        // 响应追加到连接的IOBuf：较小的meta和payload拷贝进池化块，较大的直接接管；
+        // cached不为空时meta就是缓存命中的Redis回复，只增加引用不拷贝
+        void onResponse(ConnHandle handle, Frame&& response, RequestTrace trace = RequestTrace(),
+                        const IOBuf* cached = nullptr) {
+            Connection* found = findConnection(handle.fd);
+            if (!found || found->generation != handle.generation) {
+                // 连接已关闭或fd已被新连接复用，丢弃过期的响应
+                return;
+            }
+            Connection& conn = *found;
+            if (cached && cached->empty()) cached = nullptr;
+            if (cached && trace.debug) {
+                // 调试计时要改写meta，只能先把缓存的响应拼接出来
+                response.meta = cached->toString();
+                cached = nullptr;
+            }
+            if (trace.debug && response.meta.size() > 2 && response.meta.back() == '}') {
+                // 响应本身是JSON对象，直接在末尾追加trace字段；send阶段此时还没有开始
+                trace.mark(Stage::Encode);
+                std::string meta(response.meta, 0, response.meta.size() - 1);
+                meta += ",\"trace\":" + trace.toJson().dump() + "}";
+                encodeFrameTo(conn.output, std::move(meta), std::move(response.payload));
+            } else if (cached) {
+                appendFrameHeader(conn.output, cached->size(), response.payload.size());
+                conn.output.append(*cached);
+                appendFramePadding(conn.output, cached->size());
+                conn.output.append(std::move(response.payload));
+            } else {
+                encodeFrameTo(conn.output, std::move(response.meta), std::move(response.payload));
+            }
+            trace.mark(Stage::Encode);
+            conn.trace = trace;
+            conn.state = ConnState::Writing;
+            conn.last_active = std::chrono::steady_clock::now();
+            conn.zerocopy = conn.zerocopy_capable && conn.output.size() >= options_.zerocopy_threshold;
+            if (conn.zerocopy) zerocopy_.fetch_add(1, std::memory_order_relaxed);
+            flushOutput(handle.fd, conn);
+        }
+
+        void flushOutput(int fd, Connection& conn) {
+            // 各片段由一次sendmsg交给内核，已发送的片段随即释放引用
+            bool progressed = false;
+            while (!conn.output.empty()) {
+                ssize_t n = conn.zerocopy ? conn.zerocopy_sent.send(fd, conn.output) : conn.output.sendTo(fd);
+                if (n == -1) {
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        // 有进展才顺延空闲计时，对端不读时发送停滞，由空闲定时器回收
+                        if (progressed) conn.last_active = std::chrono::steady_clock::now();
+                        conn.unsent = unsentBytes(fd);
+                        reactor_->modifyFd(fd, kWriteEvents);
                         return;
                     }
-                    freeReplyObject(reply);
+                    closeConnection(fd);
+                    return;
+                }
+                progressed = true;
+            }
 
-                    // 缓存未命中，执行服务调用
-                    auto service = registry_.getService(service_name);
-                    if (!service) {
-                        throw std::runtime_error("Service not found: " + service_name);
-                    }
+            // 响应写完，先处理已缓冲的后续请求，没有时重新布防读事件；
+            // 期间到达的数据会在布防后立即触发。内联执行的响应由processInput的循环继续处理
+            if (conn.trace.enabled) {
+                conn.trace.mark(Stage::Send);
+                trace_stats_.record(conn.trace);
+                conn.trace = RequestTrace();
+            }
+            if (!conn.zerocopy_sent.idle()) reapZeroCopy(fd, conn);
+            conn.state = ConnState::Reading;
+            conn.last_active = std::chrono::steady_clock::now();
+            idle_lru_.splice(idle_lru_.end(), busy_, conn.lru_pos);
+            if (!conn.dispatching) processInput(fd, conn);
+        }
+
+        struct MethodProfile;
+
+        // 单个请求从解码到发送响应的全部状态。单独的请求来自请求池，发送响应后reset()归还，
+        // buffer、response的容量和arena都留给下一个请求复用
+        struct Request {
+            std::string buffer;             // 整帧数据，处理期间一直由请求持有，参数视图指向这里
+            size_t meta_offset = 0;
+            size_t meta_size = 0;
+            size_t payload_offset = 0;
+            size_t payload_size = 0;
+            nlohmann::json json;
+            std::string service_name;
+            std::string method_name;
+            const LocalServiceRegistry::IdlMethod* idl = nullptr;   // IDL调用时不为空
+            uint32_t method_id = 0;
+            RequestTrace trace;             // 未抽样时不记录
+            Arena arena;                    // 处理期间的临时数据(参数数组、缓存键)，随请求整体回收
+            Frame response;
+            IOBuf cached;                   // 缓存命中时的响应，引用Redis回复的内存，发送时不拷贝
+            ConnHandle handle{-1, 0};       // 以下三项在交给线程池或合并队列时使用
+            MethodProfile* profile = nullptr;
+            std::chrono::steady_clock::time_point queued;
+
+            // JSON消息原文
+            std::string_view raw() const {
+                return std::string_view(buffer).substr(meta_offset, meta_size);
+            }
+
+            // 二进制参数
+            std::string_view payload() const {
+                return std::string_view(buffer).substr(payload_offset, payload_size);
+            }
 
-                    // 根据服务名称动态调用对应方法
-                    int result = 0;
-                    if (service_name == "compute") {
-                        auto compute_service = dynamic_cast<ComputeService<int>*>(service);
-                        if (!compute_service) {
-                            throw std::runtime_error("Invalid service type for compute");
-                        }
-                        result = compute_service->execute(method_name, args);
+            // 批量请求中的单个调用没有帧，只有JSON消息
+            void assignMeta(std::string meta) {
+                buffer = std::move(meta);
+                meta_offset = payload_offset = 0;
+                meta_size = buffer.size();
+                payload_size = 0;
+            }
+
+            void reset() {
+                resetBuffer(buffer);
+                meta_offset = meta_size = payload_offset = payload_size = 0;
+                json = nullptr;
+                service_name.clear();
+                method_name.clear();
+                idl = nullptr;
+                method_id = 0;
+                trace = RequestTrace();
+                arena.reset();
+                resetBuffer(response.meta);
+                resetBuffer(response.payload);
+                cached.clear();
+                profile = nullptr;
+            }
+        };
+
+        // 抽样或客户端要求时为请求开启分阶段计时，只在事件循环线程调用
+        void startTrace(Request& request, uint64_t read_ns, uint64_t decode_begin) {
+            // "trace"只认布尔值，其他类型按false处理；json.value()遇到类型不符会抛异常，
+            // 这里在事件循环线程上，不能让客户端的任意输入抛到Reactor::run之外
+            bool debug = false;
+            if (request.meta_size != 0) {
+                auto it = request.json.find("trace");
+                debug = it != request.json.end() && it->is_boolean() && it->get<bool>();
+            }
+            bool sampled = trace_interval_ != 0 && ++trace_counter_ % trace_interval_ == 0;
+            if (!debug && !sampled) return;
+            request.trace.begin(read_ns, decode_begin, debug);
+            request.trace.mark(Stage::Decode);
+        }
+
+        // 跨请求合并的排队状态，只在事件循环线程中访问
+        struct MethodBatcher {
+            BatchingOptions options;
+            std::vector<Request*> pending;
+            bool flush_scheduled = false;
+            TimerId timer = kInvalidTimerId;
+        };
+
+        struct Batch {
+            explicit Batch(size_t n) : requests(n), profiles(n, nullptr), responses(n) {}
+
+            // 每个响应本身就是JSON对象，直接拼接，省去重新解析
+            std::string encode() const {
+                std::string out = "{\"batch\":[";
+                for (size_t i = 0; i < responses.size(); ++i) {
+                    if (i > 0) out += ',';
+                    out += responses[i];
+                }
+                out += "]}";
+                return out;
+            }
+
+            std::vector<Request> requests;
+            std::vector<MethodProfile*> profiles;   // 为空表示该调用格式错误，已有错误响应
+            std::vector<std::string> responses;
+        };
+
+        // 每个(服务, 方法)的执行位置和耗时统计，节点在map中地址稳定，可被工作线程持有
+        struct MethodProfile {
+            std::string service_name;
+            std::string method_name;
+            MethodMetrics metrics;
+            ExecutionMode mode;
+            int64_t threshold_ns;
+            std::atomic<int64_t> avg_ns{0};         // 执行耗时的指数移动平均
+            std::atomic<uint32_t> samples{0};
+            std::atomic<bool> inline_preferred{false};
+            bool fixed_cost = false;                // 服务声明该方法的开销与参数无关
+            bool cost_known = false;                // fixed_cost已向服务查询过
+            MethodBatcher* batcher = nullptr;       // 开启了跨请求合并时不为空
+
+            // 采样足够后才允许内联，避免偶然的快速调用把昂贵方法拉到事件循环线程
+            static constexpr uint32_t kWarmupSamples = 16;
+
+            bool shouldInline() const {
+                if (mode == ExecutionMode::Inline) return true;
+                if (mode == ExecutionMode::Pool || !fixed_cost) return false;
+                return inline_preferred.load(std::memory_order_relaxed);
+            }
+
+            void record(int64_t ns) {
+                metrics.recordExecution(static_cast<uint64_t>(ns));
+                uint32_t n = samples.fetch_add(1, std::memory_order_relaxed) + 1;
+                int64_t avg = avg_ns.load(std::memory_order_relaxed);
+                avg = n == 1 ? ns : avg + (ns - avg) / 8;
+                avg_ns.store(avg, std::memory_order_relaxed);
+                if (n < kWarmupSamples) return;
+                if (avg < threshold_ns) {
+                    inline_preferred.store(true, std::memory_order_relaxed);
+                } else if (avg > 2 * threshold_ns) {
+                    inline_preferred.store(false, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        // 管理连接很少且只在事件循环线程处理，用水平触发，不设空闲超时
+        void handleNewAdminConnection() {
+            while (true) {
+                int client_fd = admin_core_->acceptConnection();
+                if (client_fd == -1) break;
+                reactor_->addFd(client_fd, EPOLLIN);
+                admin_connections_[client_fd];
+            }
+        }
+
+        void handleAdminData(int fd) {
+            AdminConnection& conn = admin_connections_[fd];
+            if (conn.output.empty()) {
+                bool open;
+                try {
+                    open = admin_core_->readData(fd, conn.input);
+                } catch (const std::exception&) {
+                    open = false;
+                }
+                if (!open || conn.input.size() > kMaxAdminRequest) {
+                    closeAdminConnection(fd);
+                    return;
+                }
+                if (conn.input.find("\r\n\r\n") == std::string::npos) return;
+                conn.output = adminResponse(conn.input);
+                reactor_->modifyFd(fd, EPOLLOUT);
+            }
+
+            while (conn.output_offset < conn.output.size()) {
+                ssize_t n = send(fd, conn.output.data() + conn.output_offset,
+                                 conn.output.size() - conn.output_offset, MSG_NOSIGNAL);
+                if (n == -1) {
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+                    break;
+                }
+                conn.output_offset += static_cast<size_t>(n);
+            }
+            closeAdminConnection(fd);
+        }
+
+        void closeAdminConnection(int fd) {
+            admin_connections_.erase(fd);
+            reactor_->removeFd(fd);
+            close(fd);
+        }
+
+        static constexpr size_t kMaxAdminRequest = 8192;
+
+        std::string adminResponse(const std::string& request) {
+            std::string status = "200 OK", body;
+            if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 14, "GET /metrics?") == 0) {
+                body = prometheusText();
+            } else {
+                status = "404 Not Found";
+                body = "Not found\n";
+            }
+            return "HTTP/1.1 " + status + "\r\n"
+                   "Content-Type: text/plain; version=0.0.4\r\n"
+                   "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                   "Connection: close\r\n\r\n" + body;
+        }
+
+        // 内置服务的方法，在事件循环线程执行
+        std::string builtinResponse(const std::string& method) {
+            if (method != "stats") {
+                return errorResponse(Status(ErrorCode::UnknownMethod,
+                                            "Unknown method: " + std::string(kBuiltinService) + "." + method));
+            }
+            nlohmann::json response;
+            response["result"] = statsJson();
+            return response.dump();
+        }
+
+        static uint64_t nanosSince(std::chrono::steady_clock::time_point begin) {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin).count());
+        }
+
+        // 各方法的指标快照，按名字排序；只在事件循环线程调用
+        std::vector<std::pair<const MethodProfile*, MethodMetricsSnapshot>> methodSnapshots() const {
+            std::vector<std::pair<const MethodProfile*, MethodMetricsSnapshot>> out;
+            for (const auto& kv : profiles_) out.emplace_back(&kv.second, kv.second.metrics.snapshot());
+            std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) {
+                return std::tie(a.first->service_name, a.first->method_name)
+                     < std::tie(b.first->service_name, b.first->method_name);
+            });
+            return out;
+        }
+
+        nlohmann::json statsJson() const {
+            ServerStats stats = getStats();
+            nlohmann::json out;
+            out["server"] = {
+                {"accepted", stats.accepted}, {"rejected", stats.rejected}, {"reaped", stats.reaped},
+                {"evicted", stats.evicted}, {"active", stats.active},
+                {"batches", stats.batches}, {"batched", stats.batched},
+                {"zerocopy", stats.zerocopy}, {"zerocopy_copied", stats.zerocopy_copied}
+            };
+            LoggerStats log = Logger::instance().stats();
+            out["log"] = {{"written", log.written}, {"dropped", log.dropped}, {"suppressed", log.suppressed}};
+            out["trace"] = {{"requests", trace_stats_.total().count()}};
+            for (size_t i = 0; i < kStageCount; ++i) {
+                out["trace"]["stages_us"][kStageNames[i]] = histogramToJson(trace_stats_.stage(i), 1e-3);
+            }
+            out["trace"]["total_us"] = histogramToJson(trace_stats_.total(), 1e-3);
+            out["methods"] = nlohmann::json::array();
+            for (const auto& item : methodSnapshots()) {
+                const MethodMetricsSnapshot& m = item.second;
+                out["methods"].push_back({
+                    {"service", item.first->service_name}, {"method", item.first->method_name},
+                    {"requests", m.requests}, {"errors", m.errors},
+                    {"cache_hits", m.cache_hits}, {"cache_misses", m.cache_misses},
+                    {"queue_wait_us", histogramToJson(m.queue_wait_ns, 1e-3)},
+                    {"execution_us", histogramToJson(m.execution_ns, 1e-3)},
+                    {"response_bytes", histogramToJson(m.response_bytes, 1)}
+                });
+            }
+            return out;
+        }
+
+        // Prometheus文本格式：每个指标族先写HELP和TYPE，再写各方法的样本
+        std::string prometheusText() const {
+            ServerStats stats = getStats();
+            std::string out;
+            auto family = [&out](const char* name, const char* type, const char* help) {
+                out += std::string("# HELP ") + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+            };
+            family("trpc_connections_active", "gauge", "Open client connections.");
+            appendPrometheusValue(out, "trpc_connections_active", "", static_cast<double>(stats.active));
+            family("trpc_connections_accepted_total", "counter", "Accepted client connections.");
+            appendPrometheusValue(out, "trpc_connections_accepted_total", "", static_cast<double>(stats.accepted));
+            family("trpc_connections_rejected_total", "counter", "Connections rejected over the limit.");
+            appendPrometheusValue(out, "trpc_connections_rejected_total", "", static_cast<double>(stats.rejected));
+            family("trpc_connections_closed_idle_total", "counter", "Connections reaped or evicted while idle.");
+            appendPrometheusValue(out, "trpc_connections_closed_idle_total", "",
+                                  static_cast<double>(stats.reaped + stats.evicted));
+            family("trpc_merged_batches_total", "counter", "Cross-request merged batches.");
+            appendPrometheusValue(out, "trpc_merged_batches_total", "", static_cast<double>(stats.batches));
+            family("trpc_zerocopy_responses_total", "counter", "Responses sent with MSG_ZEROCOPY.");
+            appendPrometheusValue(out, "trpc_zerocopy_responses_total", "", static_cast<double>(stats.zerocopy));
+            LoggerStats log = Logger::instance().stats();
+            family("trpc_log_dropped_total", "counter", "Log records dropped because a buffer was full.");
+            appendPrometheusValue(out, "trpc_log_dropped_total", "", static_cast<double>(log.dropped));
+            family("trpc_log_suppressed_total", "counter", "Log records suppressed by per-site rate limits.");
+            appendPrometheusValue(out, "trpc_log_suppressed_total", "", static_cast<double>(log.suppressed));
+
+            auto methods = methodSnapshots();
+            std::vector<std::string> labels;
+            for (const auto& item : methods) {
+                labels.push_back("service=\"" + prometheusEscape(item.first->service_name) + "\",method=\""
+                                 + prometheusEscape(item.first->method_name) + "\"");
+            }
+            auto counter = [&](const char* name, const char* help, uint64_t MethodMetricsSnapshot::*field) {
+                family(name, "counter", help);
+                for (size_t i = 0; i < methods.size(); ++i) {
+                    appendPrometheusValue(out, name, labels[i], static_cast<double>(methods[i].second.*field));
+                }
+            };
+            auto summary = [&](const char* name, const char* help, MetricHistogram MethodMetricsSnapshot::*field,
+                               double scale) {
+                family(name, "summary", help);
+                for (size_t i = 0; i < methods.size(); ++i) {
+                    appendPrometheusSummary(out, name, labels[i], methods[i].second.*field, scale);
+                }
+            };
+            counter("trpc_requests_total", "Requests handled.", &MethodMetricsSnapshot::requests);
+            counter("trpc_errors_total", "Requests that returned an error.", &MethodMetricsSnapshot::errors);
+            counter("trpc_cache_hits_total", "Redis cache hits.", &MethodMetricsSnapshot::cache_hits);
+            counter("trpc_cache_misses_total", "Redis cache misses.", &MethodMetricsSnapshot::cache_misses);
+            summary("trpc_queue_wait_seconds", "Time spent waiting in the thread pool queue.",
+                    &MethodMetricsSnapshot::queue_wait_ns, 1e-9);
+            summary("trpc_execution_seconds", "Service method execution time.",
+                    &MethodMetricsSnapshot::execution_ns, 1e-9);
+            summary("trpc_response_bytes", "Encoded response size.", &MethodMetricsSnapshot::response_bytes, 1);
+
+            family("trpc_request_stage_seconds", "summary", "Per-stage latency of sampled requests.");
+            for (size_t i = 0; i < kStageCount; ++i) {
+                appendPrometheusSummary(out, "trpc_request_stage_seconds",
+                                        std::string("stage=\"") + kStageNames[i] + "\"", trace_stats_.stage(i), 1e-9);
+            }
+            return out;
+        }
+
+        // 只在事件循环线程(或start()之前)调用
+        MethodProfile* getProfile(const std::string& service_name, const std::string& method_name) {
+            // 查找用的键拼在复用的缓冲区里，已有的profile不必为每个请求分配字符串
+            profile_key_.assign(service_name).append(1, '.').append(method_name);
+            auto it = profiles_.find(profile_key_);
+            if (it == profiles_.end()) {
+                it = profiles_.emplace(std::piecewise_construct,
+                                       std::forward_as_tuple(profile_key_),
+                                       std::forward_as_tuple()).first;
+                it->second.service_name = service_name;
+                it->second.method_name = method_name;
+                it->second.mode = options_.default_execution_mode;
+                it->second.threshold_ns = options_.inline_threshold.count();
+            }
+            return &it->second;
+        }
+
+        // 从请求JSON中取出服务名和方法名
+        static Status readCallName(Request& request) {
+            const nlohmann::json& json = request.json;
+            if (!json.is_object()) {
+                return Status(ErrorCode::BadRequest, "Malformed request");
+            }
+            auto service = json.find("service_name");
+            auto method = json.find("method_name");
+            if (service == json.end() || !service->is_string() || method == json.end() || !method->is_string()) {
+                return Status(ErrorCode::BadRequest, "Request must name a service and a method");
+            }
+            request.service_name = service->get_ref<const std::string&>();
+            request.method_name = method->get_ref<const std::string&>();
+            return Status();
+        }
+
+        // 只在事件循环线程调用：确认服务和方法都存在后才取profile，不存在的名字不会留下profile
+        Result<MethodProfile*> resolveMethod(const Request& request) {
+            BaseService* service = registry_.getService(request.service_name);
+            if (!service) {
+                return Status(ErrorCode::UnknownService, "Service not found: " + request.service_name);
+            }
+            if (!service->hasMethod(request.method_name)) {
+                return Status(ErrorCode::UnknownMethod,
+                              "Unknown method: " + request.service_name + "." + request.method_name);
+            }
+            MethodProfile* profile = getProfile(request.service_name, request.method_name);
+            if (!profile->cost_known) {
+                profile->fixed_cost = service->hasFixedCost(request.method_name);
+                profile->cost_known = true;
+            }
+            return profile;
+        }
+
+        // 只在事件循环线程调用：从payload取出方法id，找到对应的方法和profile
+        Result<MethodProfile*> resolveIdlMethod(Request& request) {
+            std::string_view payload = request.payload();
+            if (payload.size() < sizeof(uint32_t)) {
+                return Status(ErrorCode::BadRequest, "Missing method id");
+            }
+            memcpy(&request.method_id, payload.data(), sizeof(uint32_t));
+            request.idl = registry_.findMethod(request.method_id);
+            if (!request.idl) {
+                return Status(ErrorCode::UnknownMethod, "Unknown method id: " + std::to_string(request.method_id));
+            }
+            MethodProfile*& profile = idl_profiles_[request.method_id];
+            if (!profile) {
+                profile = getProfile(request.idl->service_name, request.idl->method_name);
+            }
+            return profile;
+        }
+
+        // 错误响应：{"error": 描述, "code": 错误码}
+        static std::string errorResponse(const Status& status) {
+            TRPC_LOG(LogLevel::Warn, "Error processing message: {}", status.message());
+            nlohmann::json error_response;
+            error_response["error"] = status.message();
+            error_response["code"] = static_cast<int>(status.code());
+            return error_response.dump();
+        }
+
+        // 批量请求：{"batch": [{"service_name", "method_name", "args"}, ...]}，
+        // 各调用互相独立，响应为{"batch": [每个调用的result或error, ...]}，顺序与请求一致
+        void processBatch(ConnHandle handle, const Request& envelope) {
+            const auto& calls = envelope.json["batch"];
+            if (!calls.is_array() || calls.size() > options_.max_batch_size) {
+                onResponse(handle, Frame{errorResponse(Status(ErrorCode::BadRequest, "Batch must be an array of at most "
+                    + std::to_string(options_.max_batch_size) + " calls")), std::string()});
+                return;
+            }
+            if (envelope.payload_size != 0) {
+                onResponse(handle, Frame{errorResponse(Status(ErrorCode::BadRequest,
+                                                              "Batch requests cannot carry a payload")), std::string()});
+                return;
+            }
+
+            // 解析和查找profile在事件循环线程完成，单个调用格式错误只影响它自己
+            auto batch = std::make_shared<Batch>(calls.size());
+            bool all_inline = true;
+            for (size_t i = 0; i < calls.size(); ++i) {
+                Request& request = batch->requests[i];
+                request.json = calls[i];
+                Status status = readCallName(request);
+                Result<MethodProfile*> profile = status.ok() ? resolveMethod(request) : Result<MethodProfile*>(status);
+                if (!profile) {
+                    batch->responses[i] = errorResponse(profile.status());
+                    continue;
+                }
+                request.assignMeta(request.json.dump());
+                batch->profiles[i] = profile.value();
+                all_inline = all_inline && batch->profiles[i]->shouldInline();
+            }
+
+            if (all_inline) {
+                // 全是廉价方法时和单个请求一样直接在事件循环线程执行
+                runBatch(*batch, nullptr);
+                onResponse(handle, Frame{batch->encode(), std::string()});
+                return;
+            }
+
+            auto queued = std::chrono::steady_clock::now();
+            threadPool_->addTask([this, handle, batch, queued]() {
+                uint64_t wait = nanosSince(queued);
+                for (MethodProfile* profile : batch->profiles) {
+                    if (profile) profile->metrics.recordQueueWait(wait);
+                }
+                runBatch(*batch, threadPool_.get());
+                reactor_->post([this, handle, response = batch->encode()]() mutable {
+                    onResponse(handle, Frame{std::move(response), std::string()});
+                });
+            });
+        }
+
+        // 请求先在事件循环线程中排队，凑满一批或等待超时后整批交给线程池
+        void addToBatch(MethodProfile& profile, Request* request) {
+            MethodBatcher& batcher = *profile.batcher;
+            batcher.pending.push_back(request);
+            if (batcher.pending.size() >= batcher.options.max_batch_size) {
+                flushBatch(profile);
+                return;
+            }
+            if (batcher.flush_scheduled) return;
+            batcher.flush_scheduled = true;
+            if (batcher.options.max_wait.count() == 0) {
+                // 投递的任务在本轮事件处理完之后执行
+                reactor_->post([this, &profile]() { flushBatch(profile); });
+            } else {
+                batcher.timer = reactor_->runAfter(batcher.options.max_wait, [this, &profile]() {
+                    profile.batcher->timer = kInvalidTimerId;
+                    flushBatch(profile);
+                });
+            }
+        }
+
+        void flushBatch(MethodProfile& profile) {
+            MethodBatcher& batcher = *profile.batcher;
+            batcher.flush_scheduled = false;
+            reactor_->cancelTimer(batcher.timer);
+            batcher.timer = kInvalidTimerId;
+            if (batcher.pending.empty()) return;
+
+            auto calls = std::make_shared<std::vector<Request*>>(std::move(batcher.pending));
+            batcher.pending.clear();
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            batched_.fetch_add(calls->size(), std::memory_order_relaxed);
+            auto queued = std::chrono::steady_clock::now();
+            threadPool_->addTask([this, &profile, calls, queued]() {
+                uint64_t wait = nanosSince(queued);
+                for (size_t i = 0; i < calls->size(); ++i) profile.metrics.recordQueueWait(wait);
+                runMerged(profile, *calls);
+                reactor_->post([this, calls]() {
+                    for (Request* request : *calls) respond(request);
+                });
+            });
+        }
+
+        // 整批做一次向量运算，响应写入各请求；参数不合规或运算出错(如整数除零)时退回逐个执行，
+        // 错误只返回给出错的请求
+        void runMerged(MethodProfile& profile, const std::vector<Request*>& calls) {
+            const Request& first = *calls.front();
+            BaseService* service = registry_.getService(first.service_name);
+            bool merged = false;
+            auto begin = std::chrono::steady_clock::now();
+            if (auto compute_i32 = dynamic_cast<ComputeService<int>*>(service)) {
+                merged = runVectorized(*compute_i32, first.method_name, calls);
+            } else if (auto compute_f32 = dynamic_cast<ComputeService<float>*>(service)) {
+                merged = runVectorized(*compute_f32, first.method_name, calls);
+            } else if (auto compute_f64 = dynamic_cast<ComputeService<double>*>(service)) {
+                merged = runVectorized(*compute_f64, first.method_name, calls);
+            }
+            if (!merged) {
+                for (Request* request : calls) {
+                    invoke(*request, profile, request->response);
+                }
+                return;
+            }
+            // 合并执行的耗时平摊到每个请求
+            uint64_t per_call = nanosSince(begin) / calls.size();
+            for (const Request* request : calls) {
+                profile.metrics.recordExecution(per_call);
+                profile.metrics.recordRequest(true, request->response.meta.size());
+            }
+        }
+
+        template <typename T>
+        static bool runVectorized(ComputeService<T>& service, const std::string& method,
+                                  const std::vector<Request*>& calls) {
+            std::vector<T> a(calls.size()), b(calls.size());
+            for (size_t i = 0; i < calls.size(); ++i) {
+                const nlohmann::json& json = calls[i]->json;
+                auto args = json.find("args");
+                if (args == json.end() || !args->is_array() || args->size() != 2 || !(*args)[0].is_number()
+                    || !(*args)[1].is_number() || calls[i]->payload_size != 0) {
+                    return false;
+                }
+                a[i] = (*args)[0].get<T>();
+                b[i] = (*args)[1].get<T>();
+            }
+            Result<std::vector<T>> c = service.callArray("v" + method, a, b);
+            if (!c) return false;
+            for (size_t i = 0; i < calls.size(); ++i) {
+                encodeResult(calls[i]->response.meta, c.value()[i]);
+            }
+            return true;
+        }
+
+        // 执行批量请求中的各个调用；pool不为空时按块分给线程池，调用线程也参与
+        void runBatch(Batch& batch, ThreadPool* pool) {
+            size_t n = batch.requests.size();
+            size_t workers = pool ? pool->size() + 1 : 1;
+            parallelFor(pool, n, std::max<size_t>(1, n / (workers * 4)), [&](size_t, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    if (!batch.profiles[i]) continue;
+                    Request& request = batch.requests[i];
+                    if (pool) {
+                        RequestTrace untraced;
+                        processRequest(request, *batch.profiles[i], untraced);
                     } else {
-                        // 可以在这里添加其他服务类型的处理
-                        throw std::runtime_error("Unsupported service type: " + service_name);
+                        invoke(request, *batch.profiles[i], request.response);
                     }
-                    
-                    // 构造响应
-                    nlohmann::json response;
-                    response["result"] = result;
-                    std::string response_str = response.dump();
-                    
-                    // 将结果存入缓存，设置过期时间
-                    // std::string result_str = result.dump();
-                    redisCommand(redis_context_, "SETEX %s 3600 %s", 
-                                cache_key.c_str(), response_str.c_str());
-
-                    // 发送响应
-                    if (send(fd, response_str.c_str(), response_str.size(), 0) == -1) {
-                        throw std::runtime_error("Failed to send response");
-                    }
-                } catch (const std::exception& e) {
-                    std::cerr << "Error processing message: " << e.what() << std::endl;
-                    
-                    // 发送错误响应
-                    nlohmann::json error_response;
-                    error_response["error"] = e.what();
-                    std::string error_str = error_response.dump();
-                    send(fd, error_str.c_str(), error_str.size(), 0);
+                    batch.responses[i] = request.cached.empty() ? std::move(request.response.meta)
+                                                                : request.cached.toString();
                 }
             });
         }
 
+        // 在工作线程中执行：查缓存、调用服务、写缓存，要发送的响应写入request.response；
+        // 带二进制参数的请求(如矩阵)体积大且很少重复，TypedService的调用没有JSON参数，都不经过缓存
+        void processRequest(Request& request, MethodProfile& profile, RequestTrace& trace) {
+            Frame& response = request.response;
+            if (request.payload_size != 0 || !request.json.contains("args")) {
+                invoke(request, profile, response);
+                trace.mark(Stage::Execute);
+                return;
+            }
+
+            std::string_view cache_key = makeCacheKey(request.arena, request.service_name, request.method_name,
+                                                      request.raw());
+
+            // 尝试从缓存获取结果
+            bool hit = lookupCache(cache_key, request.cached);
+            trace.mark(Stage::Cache);
+            profile.metrics.recordCache(hit);
+            if (hit) {
+                profile.metrics.recordRequest(true, request.cached.size());
+                return;
+            }
+
+            // 缓存未命中，执行服务调用，只缓存成功的结果；写缓存也计入cache阶段
+            bool ok = invoke(request, profile, response);
+            trace.mark(Stage::Execute);
+            if (ok && response.payload.empty()) {
+                storeCache(cache_key, response.meta);
+                trace.mark(Stage::Cache);
+            }
+        }
+
+        // 调用服务方法并编码响应，同时记录执行耗时；失败时response为错误响应。
+        // 预期的失败由invokeService以Status返回，服务实现抛出的异常在这里按类型转换为错误码
+        bool invoke(Request& request, MethodProfile& profile, Frame& response_frame) {
+            Status status;
+            try {
+                status = invokeService(request, profile, response_frame);
+            } catch (const std::exception& e) {
+                status = statusFromException(e);
+            }
+            if (!status.ok()) {
+                response_frame.meta = errorResponse(status);
+                response_frame.payload.clear();
+                profile.metrics.recordRequest(false, response_frame.meta.size());
+                return false;
+            }
+            return true;
+        }
+
+        static const nlohmann::json& argsOf(const Request& request) {
+            static const nlohmann::json kNoArgs;
+            auto it = request.json.find("args");
+            return it == request.json.end() ? kNoArgs : *it;
+        }
+
+        Status invokeService(Request& request, MethodProfile& profile, Frame& response_frame) {
+            if (request.idl) {
+                // IDL方法按id直接分发；成功时meta为空，返回值在payload中
+                response_frame.payload.clear();
+                auto begin = std::chrono::steady_clock::now();
+                std::string_view payload = request.payload();
+                BinaryReader reader(payload.data() + sizeof(uint32_t), payload.size() - sizeof(uint32_t),
+                                    sizeof(uint32_t));
+                request.idl->service->dispatch(request.method_id, reader, response_frame.payload);
+                profile.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin).count());
+                response_frame.meta.clear();
+                profile.metrics.recordRequest(true, response_frame.payload.size());
+                return Status();
+            }
+
+            auto service = registry_.getService(request.service_name);
+            if (!service) {
+                return Status(ErrorCode::UnknownService, "Service not found: " + request.service_name);
+            }
+
+            // 根据服务类型动态调用对应方法，计时包含参数转换，
+            // 内联与否取决于事件循环线程上的总开销
+            Result<nlohmann::json> result = nlohmann::json();
+            response_frame.payload.clear();
+            auto begin = std::chrono::steady_clock::now();
+            if (auto typed = dynamic_cast<TypedService*>(service)) {
+                // 参数和返回值都是二进制编码，放在payload中，result为空
+                typed->invoke(request.method_name, request.payload(), response_frame.payload);
+            } else if (auto compute_i32 = dynamic_cast<ComputeService<int>*>(service)) {
+                result = invokeCompute(*compute_i32, request.method_name, argsOf(request),
+                                       request.payload(), response_frame.payload, request.arena);
+            } else if (auto compute_f32 = dynamic_cast<ComputeService<float>*>(service)) {
+                result = invokeCompute(*compute_f32, request.method_name, argsOf(request),
+                                       request.payload(), response_frame.payload, request.arena);
+            } else if (auto compute_f64 = dynamic_cast<ComputeService<double>*>(service)) {
+                result = invokeCompute(*compute_f64, request.method_name, argsOf(request),
+                                       request.payload(), response_frame.payload, request.arena);
+            } else {
+                // 可以在这里添加其他服务类型的处理
+                return Status(ErrorCode::Internal, "Unsupported service type: " + request.service_name);
+            }
+            profile.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin).count());
+            if (!result) return result.status();
+            
+            // 构造响应
+            encodeResult(response_frame.meta, result.value());
+            profile.metrics.recordRequest(true, response_frame.meta.size() + response_frame.payload.size());
+            return Status();
+        }
+
+        // 按方法类别转换参数并调用计算服务；矩阵方法的操作数和结果走二进制payload。
+        // 参数类型和个数在这里检查，错误以Status返回，不把nlohmann的异常信息带给客户端
+        template <typename T>
+        Result<nlohmann::json> invokeCompute(ComputeService<T>& service, const std::string& method,
+                                             const nlohmann::json& args, std::string_view payload,
+                                             std::string& out_payload, Arena& arena) {
+            using Array = std::vector<T>;
+            if (ComputeService<T>::isScalarMethod(method)) {
+                // 参数数组放在请求的arena中
+                size_t count = args.is_array() ? args.size() : 0;
+                T* values = arena.allocateArray<T>(count);
+                if (!args.is_array() || !readNumbers(args, values)) {
+                    return Status(ErrorCode::InvalidArgument, "Numeric arguments expected for " + method);
+                }
+                Result<T> result = service.call(method, values, count);
+                if (!result) return result.status();
+                return nlohmann::json(result.value());
+            }
+            if (method == "eval") {
+                // 表达式DAG：一次往返完成多个相互依赖的调用，节点不能再嵌套eval或携带payload；
+                // 节点的错误以StatusError抛出，保留错误码。同层节点并行求值，各用自己的arena
+                ExprDag dag(args);
+                return dag.evaluate([this, &service](const std::string& op, const nlohmann::json& node_args) {
+                    if (op == "eval") throw std::invalid_argument("Nested eval is not allowed");
+                    std::string unused;
+                    Arena node_arena(256);
+                    Result<nlohmann::json> result = invokeCompute(service, op, node_args, std::string(), unused,
+                                                                  node_arena);
+                    if (!result) throw StatusError(result.status());
+                    return std::move(result.value());
+                }, threadPool_.get());
+            }
+            if (ComputeService<T>::isArrayMethod(method)) {
+                // 批量方法：args为[数组, 数组]或[数组, 标量]
+                Array a, b;
+                bool valid = args.is_array() && args.size() == 2 && readArray(args[0], a);
+                if (valid && args[1].is_number()) {
+                    b.assign(1, args[1].get<T>());
+                } else {
+                    valid = valid && readArray(args[1], b);
+                }
+                if (!valid) {
+                    return Status(ErrorCode::InvalidArgument, "An array and an array or scalar expected for " + method);
+                }
+                Result<Array> result = service.callArray(method, a, b);
+                if (!result) return result.status();
+                return nlohmann::json(std::move(result.value()));
+            }
+            if (ComputeService<T>::isReduceMethod(method)) {
+                // 归约方法：args为数组
+                Array values;
+                if (!readArray(args, values)) {
+                    return Status(ErrorCode::InvalidArgument, "Numeric array expected for " + method);
+                }
+                return nlohmann::json(service.reduce(method, values));
+            }
+            if (method == "dot") {
+                // args为[数组, 数组]
+                Array a, b;
+                if (!args.is_array() || args.size() != 2 || !readArray(args[0], a) || !readArray(args[1], b)) {
+                    return Status(ErrorCode::InvalidArgument, "Two numeric arrays expected for dot");
+                }
+                return nlohmann::json(service.dot(a, b));
+            }
+            if (method == "histogram") {
+                // args为[数组, [桶数, 下界, 上界]]
+                Array values;
+                size_t bins = 0;
+                bool valid = args.is_array() && args.size() == 2 && readArray(args[0], values);
+                const nlohmann::json* range = valid ? &args[1] : nullptr;
+                valid = valid && range->is_array() && range->size() == 3 && readSize((*range)[0], bins)
+                        && (*range)[1].is_number() && (*range)[2].is_number();
+                if (!valid) {
+                    return Status(ErrorCode::InvalidArgument, "An array and [bins, low, high] expected for histogram");
+                }
+                return nlohmann::json(service.histogram(values, bins, (*range)[1].get<double>(),
+                                                        (*range)[2].get<double>()));
+            }
+            if (method == "gemm") {
+                // args为[m, n, k]，payload依次为A(m×k)和B(k×n)，结果C(m×n)放在响应payload中
+                size_t m = 0, n = 0, k = 0;
+                if (!args.is_array() || args.size() != 3 || !readSize(args[0], m) || !readSize(args[1], n)
+                    || !readSize(args[2], k)) {
+                    return Status(ErrorCode::InvalidArgument, "Dimensions [m, n, k] expected for gemm");
+                }
+                checkMatrixSize<T>(m, k);
+                checkMatrixSize<T>(k, n);
+                checkMatrixSize<T>(m, n);
+                std::vector<T> copy;
+                const T* a = operandView<T>(payload, m * k + k * n, copy);
+                service.gemm(m, n, k, a, a + m * k, resultBuffer<T>(out_payload, m * n));
+                return nlohmann::json{m, n};
+            }
+            if (method == "gemv") {
+                // args为[m, n]，payload依次为A(m×n)和x(n)，结果y(m)放在响应payload中
+                size_t m = 0, n = 0;
+                if (!args.is_array() || args.size() != 2 || !readSize(args[0], m) || !readSize(args[1], n)) {
+                    return Status(ErrorCode::InvalidArgument, "Dimensions [m, n] expected for gemv");
+                }
+                checkMatrixSize<T>(m, n);
+                std::vector<T> copy;
+                const T* a = operandView<T>(payload, m * n + n, copy);
+                service.gemv(m, n, a, a + m * n, resultBuffer<T>(out_payload, m));
+                return nlohmann::json{m};
+            }
+            return Status(ErrorCode::UnknownMethod, "Unknown method: " + method);
+        }
+
+        // 把JSON数组转换为数值数组，类型不对时返回false，不抛异常
+        template <typename T>
+        static bool readArray(const nlohmann::json& value, std::vector<T>& out) {
+            if (!value.is_array()) return false;
+            out.resize(value.size());
+            return readNumbers(value, out.data());
+        }
+
+        // value必须是数组，out至少能放下value.size()个元素
+        template <typename T>
+        static bool readNumbers(const nlohmann::json& value, T* out) {
+            for (const auto& item : value) {
+                if (!item.is_number()) return false;
+                *out++ = item.get<T>();
+            }
+            return true;
+        }
+
+        // 读取非负整数(维数、桶数)，类型不对时返回false
+        static bool readSize(const nlohmann::json& value, size_t& out) {
+            if (!value.is_number_unsigned()) return false;
+            out = value.get<size_t>();
+            return true;
+        }
+
+        // 成功响应{"result": ...}直接写入meta，复用其容量；整数结果不经过JSON序列化
+        static void encodeResult(std::string& meta, const nlohmann::json& result) {
+            meta.assign("{\"result\":");
+            char digits[24];
+            if (result.is_number_unsigned()) {
+                meta.append(digits, std::to_chars(digits, digits + sizeof(digits), result.get<uint64_t>()).ptr);
+            } else if (result.is_number_integer()) {
+                meta.append(digits, std::to_chars(digits, digits + sizeof(digits), result.get<int64_t>()).ptr);
+            } else {
+                meta += result.dump();
+            }
+            meta += '}';
+        }
+
+        // 矩阵不能超过一帧的大小，同时避免维度相乘溢出
+        template <typename T>
+        static void checkMatrixSize(size_t rows, size_t cols) {
+            size_t limit = kDefaultMaxFrameSize / sizeof(T);
+            if (rows > limit || cols > limit || (rows != 0 && cols > limit / rows)) {
+                throw std::invalid_argument("Matrix too large");
+            }
+        }
+
+        // 操作数直接指向请求持有的接收缓冲区；payload在帧内按8字节对齐，
+        // 只有缓冲区本身未对齐时才退回拷贝到copy中
+        template <typename T>
+        static const T* operandView(std::string_view payload, size_t count, std::vector<T>& copy) {
+            if (payload.size() != count * sizeof(T)) {
+                throw std::invalid_argument("Payload size does not match matrix dimensions");
+            }
+            if (reinterpret_cast<uintptr_t>(payload.data()) % alignof(T) == 0) {
+                return reinterpret_cast<const T*>(payload.data());
+            }
+            copy.resize(count);
+            memcpy(copy.data(), payload.data(), payload.size());
+            return copy.data();
+        }
+
+        // 结果直接写进响应payload，省去一次拷贝
+        template <typename T>
+        static T* resultBuffer(std::string& out_payload, size_t count) {
+            out_payload.resize(count * sizeof(T));
+            return reinterpret_cast<T*>(&out_payload[0]);
+        }
+
+        // hiredis连接不是线程安全的，多个工作线程共用时需要加锁
+        // 命中时value引用回复中的字节，回复在响应发送完后才释放
+        bool lookupCache(std::string_view key, IOBuf& value) {
+            redisReply* reply;
+            {
+                std::lock_guard<std::mutex> lock(redis_mutex_);
+                reply = (redisReply*)redisCommand(redis_context_, "GET %b", key.data(), key.size());
+            }
+            if (!reply || reply->type != REDIS_REPLY_STRING) {
+                freeReplyObject(reply);
+                return false;
+            }
+            value.appendExternal(reply->str, reply->len, freeReplyObject, reply);
+            return true;
+        }
+
+        // 将结果存入缓存，设置过期时间
+        void storeCache(std::string_view key, const std::string& value) {
+            std::lock_guard<std::mutex> lock(redis_mutex_);
+            freeReplyObject(redisCommand(redis_context_, "SETEX %b 3600 %b",
+                                         key.data(), key.size(), value.data(), value.size()));
+        }
+
         int port_;
+        ServerOptions options_;
         std::unique_ptr<ServerCore> server_core_;
+        std::unique_ptr<ServerCore> admin_core_;    // 未开启管理端口时为空
+        std::unique_ptr<ServerCore> unix_core_;     // 未设置unix_path时为空
         std::unique_ptr<Reactor> reactor_;
+        // 只在事件循环线程中使用；在线程池之后析构，线程池退出前执行完的任务仍可访问请求
+        SlabPool<Connection> connection_pool_;
+        SlabPool<Request> request_pool_;
         std::unique_ptr<ThreadPool> threadPool_;
         LocalServiceRegistry registry_;
         redisContext* redis_context_;
+        std::mutex redis_mutex_;
+        std::unordered_map<std::string, MethodProfile> profiles_;
+        std::string profile_key_;
+        std::unordered_map<uint32_t, MethodProfile*> idl_profiles_;
+        std::unordered_map<std::string, std::unique_ptr<MethodBatcher>> batchers_;
+        uint64_t trace_interval_;       // 每隔多少个请求抽样一个，0表示不抽样
+        uint64_t trace_counter_ = 0;
+        TraceStats trace_stats_;
+
+        std::vector<Connection*> connections_;  // 按fd索引，未使用的fd为空
+        size_t connection_count_ = 0;
+        std::unordered_map<int, AdminConnection> admin_connections_;
+        std::list<int> idle_lru_;       // 按最后活动时间排序，队首最久未活动
+        std::list<int> busy_;           // 处理中的连接，不参与回收
+        std::list<int> spare_lru_;      // 已关闭连接留下的链表节点，供新连接复用
+        std::unordered_map<int, ZeroCopyTracker> draining_;     // 已关闭但零拷贝发送还未完成的fd
+        uint32_t next_generation_ = 0;
+        std::atomic<uint64_t> accepted_{0};
+        std::atomic<uint64_t> rejected_{0};
+        std::atomic<uint64_t> reaped_{0};
+        std::atomic<uint64_t> evicted_{0};
+        std::atomic<uint64_t> active_{0};
+        std::atomic<uint64_t> batches_{0};
+        std::atomic<uint64_t> batched_{0};
+        std::atomic<uint64_t> zerocopy_{0};
+        std::atomic<uint64_t> zerocopy_copied_{0};
 };
 
 } // namespace trpc 
\ No newline at end of file
@@ -1,27 +1,100 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <unordered_map>
 #include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <string_view>
+
+#include "simd.hpp"
+#include "gemm.hpp"
+#include "threadpool.hpp"
+#include "codec.hpp"
+#include "status.hpp"
 
 /*
     服务和实现
     +本地服务注册器
+    +IdlService ： IDL生成的服务骨架的基类，按方法id分发
+    +TypedService ： 按成员函数签名注册方法，参数和返回值走二进制编解码
 */
 namespace trpc {
 
 class BaseService {
     public:
-        BaseService(const std::string& name) : name_(name) {}
+        BaseService(const std::string& name) : name_(name), pool_(nullptr) {}
         virtual ~BaseService() = default;
 
+        const std::string& name() const { return name_; }
+
+        // 分发前检查方法名，不存在时直接返回错误而不必调用服务；默认不检查，由调用时报告
+        virtual bool hasMethod(const std::string&) const { return true; }
+
+        // 执行耗时与参数内容无关的方法。自适应模式只会把这类方法改为内联执行：
+        // 耗时随输入增长的方法平均再快，遇到一个大请求也会长时间阻塞事件循环线程
+        virtual bool hasFixedCost(const std::string&) const { return false; }
+
+        // 注册到Server时注入其线程池，服务可以用它做并行计算
+        void setThreadPool(ThreadPool* pool) { pool_ = pool; }
+
+    protected:
+        ThreadPool* threadPool() const { return pool_; }
+
     private:
         std::string name_;
+        ThreadPool* pool_;
+};
+
+// 生成的骨架在构造时登记方法id，dispatch用switch分发，运行时不按名字查找
+class IdlService : public BaseService {
+    public:
+        struct MethodInfo {
+            uint32_t id;
+            const char* name;
+        };
+
+        IdlService(const std::string& name, std::vector<MethodInfo> methods)
+            : BaseService(name), methods_(std::move(methods)) {}
+
+        const std::vector<MethodInfo>& methods() const { return methods_; }
+
+        // 从reader解码参数，调用方法，把返回值编码到out
+        virtual void dispatch(uint32_t method_id, BinaryReader& reader, std::string& out) = 0;
+
+    private:
+        std::vector<MethodInfo> methods_;
 };
 
 class LocalServiceRegistry {
     public:
+        // 按方法id找到的IDL方法
+        struct IdlMethod {
+            IdlService* service;
+            std::string service_name;
+            std::string method_name;
+        };
+
         void registerService(const std::string& name, std::unique_ptr<BaseService> service) {
+            auto old = services_.find(name);
+            if (old != services_.end()) {
+                unindex(old->second.get());
+            }
+            if (auto idl = dynamic_cast<IdlService*>(service.get())) {
+                for (const auto& method : idl->methods()) {
+                    if (method_index_.count(method.id)) {
+                        throw std::invalid_argument("Duplicate method id for " + name + "." + method.name);
+                    }
+                }
+                for (const auto& method : idl->methods()) {
+                    method_index_[method.id] = IdlMethod{idl, name, method.name};
+                }
+            }
             services_[name] = std::move(service);
         }
 
@@ -33,15 +106,115 @@ class LocalServiceRegistry {
             return nullptr;
         }
 
+        const IdlMethod* findMethod(uint32_t method_id) const {
+            auto it = method_index_.find(method_id);
+            return it == method_index_.end() ? nullptr : &it->second;
+        }
+
     private:
+        void unindex(BaseService* service) {
+            for (auto it = method_index_.begin(); it != method_index_.end();) {
+                it = it->second.service == service ? method_index_.erase(it) : std::next(it);
+            }
+        }
+
         std::unordered_map<std::string, std::unique_ptr<BaseService>> services_;
+        std::unordered_map<uint32_t, IdlMethod> method_index_;
 }; 
 
+// 带类型的服务：method("scale", &Svc::scale)在编译期推导参数和返回类型，
+// 为每个签名生成专门的解码、调用、编码代码；参数和返回值都在二进制payload中
+class TypedService : public BaseService {
+    public:
+        using BaseService::BaseService;
+
+        bool hasMethod(const std::string& name) const override {
+            return methods_.count(name) != 0;
+        }
+
+        // 从args解码参数，调用方法，把返回值编码到out；void方法不写out
+        void invoke(const std::string& name, std::string_view args, std::string& out) {
+            auto it = methods_.find(name);
+            if (it == methods_.end()) {
+                throw std::runtime_error("Unknown method: " + name);
+            }
+            BinaryReader reader(args);
+            it->second->call(reader, out);
+        }
+
+    protected:
+        template <typename Svc, typename R, typename... Args>
+        void method(const std::string& name, R (Svc::*fn)(Args...)) {
+            addMethod<Svc, R, Args...>(name, fn);
+        }
+
+        template <typename Svc, typename R, typename... Args>
+        void method(const std::string& name, R (Svc::*fn)(Args...) const) {
+            addMethod<Svc, R, Args...>(name, fn);
+        }
+
+    private:
+        struct Handler {
+            virtual ~Handler() = default;
+            virtual void call(BinaryReader& reader, std::string& out) = 0;
+        };
+
+        template <typename Svc, typename Fn, typename R, typename... Args>
+        struct MethodHandler : Handler {
+            MethodHandler(Svc* self, Fn fn) : self_(self), fn_(fn) {}
+
+            void call(BinaryReader& reader, std::string& out) override {
+                auto args = decodeValues<std::decay_t<Args>...>(reader);
+                if constexpr (std::is_void<R>::value) {
+                    std::apply([this](auto&... values) { (self_->*fn_)(values...); }, args);
+                } else {
+                    Codec<std::decay_t<R>>::encode(out, std::apply([this](auto&... values) -> R {
+                        return (self_->*fn_)(values...);
+                    }, args));
+                }
+            }
+
+            Svc* self_;
+            Fn fn_;
+        };
+
+        template <typename Svc, typename R, typename... Args, typename Fn>
+        void addMethod(const std::string& name, Fn fn) {
+            static_assert(std::is_base_of<TypedService, Svc>::value, "Method must belong to a TypedService");
+            methods_[name] = std::make_unique<MethodHandler<Svc, Fn, R, Args...>>(static_cast<Svc*>(this), fn);
+        }
+
+        std::unordered_map<std::string, std::unique_ptr<Handler>> methods_;
+};
+
 template <typename T>
 class ComputeService : public BaseService {
     public:
         ComputeService() : BaseService("compute") {}
-        T execute(const std::string& method, const std::vector<T>& args) {
+
+        bool hasMethod(const std::string& method) const override {
+            return isScalarMethod(method) || isArrayMethod(method) || isReduceMethod(method) || method == "dot"
+                || method == "histogram" || method == "gemm" || method == "gemv" || method == "eval";
+        }
+
+        // 只有标量方法的开销固定；数组、归约、矩阵、直方图和表达式的开销取决于参数
+        bool hasFixedCost(const std::string& method) const override { return isScalarMethod(method); }
+
+        // 标量方法：add/sub/mul/div
+        static bool isScalarMethod(const std::string& method) {
+            return method == "add" || method == "sub" || method == "mul" || method == "div";
+        }
+
+        // 失败(参数不足、方法不存在、整数除零或商溢出)时返回错误状态，不抛异常
+        Result<T> call(const std::string& method, const std::vector<T>& args) {
+            return call(method, args.data(), args.size());
+        }
+
+        // 参数可以放在调用方的任意缓冲区中(如请求的arena)
+        Result<T> call(const std::string& method, const T* args, size_t count) {
+            if (count < 2) {
+                return Status(ErrorCode::InvalidArgument, "Two arguments expected for " + method);
+            }
             if (method == "add") {
                 return add(args[0], args[1]);
             } else if (method == "sub") {
@@ -49,15 +222,192 @@ class ComputeService : public BaseService {
             } else if (method == "mul") {
                 return mul(args[0], args[1]);
             } else if (method == "div") {
+                if (hasZeroDivisor(&args[1], 1)) return divisionByZero();
+                if (overflowsDivision(&args[0], 1, &args[1], false)) return divisionOverflow();
                 return div(args[0], args[1]);
             }
-            throw std::runtime_error("Unknown method: " + method);
+            return Status(ErrorCode::UnknownMethod, "Unknown method: " + method);
+        }
+
+        T execute(const std::string& method, const std::vector<T>& args) {
+            Result<T> result = call(method, args);
+            if (!result) result.status().raise();
+            return result.value();
+        }
+
+        // 批量方法：vadd/vsub/vmul/vdiv对两个等长数组逐元素运算，
+        // vadds/vsubs/vmuls/vdivs把数组的每个元素与标量b[0]运算
+        static bool isArrayMethod(const std::string& method) {
+            return findArrayMethod(method) != nullptr;
+        }
+
+        Result<std::vector<T>> callArray(const std::string& method, const std::vector<T>& a,
+                                         const std::vector<T>& b) {
+            const ArrayMethod* m = findArrayMethod(method);
+            if (!m) {
+                return Status(ErrorCode::UnknownMethod, "Unknown method: " + method);
+            }
+            if (m->broadcast ? b.size() != 1 : a.size() != b.size()) {
+                return Status(ErrorCode::InvalidArgument, m->broadcast ? "Scalar operand expected for " + method
+                                                                       : "Array length mismatch for " + method);
+            }
+            if (m->op == simd::BinaryOp::Div && hasZeroDivisor(b.data(), b.size())) {
+                return divisionByZero();
+            }
+            if (m->op == simd::BinaryOp::Div && overflowsDivision(a.data(), a.size(), b.data(), m->broadcast)) {
+                return divisionOverflow();
+            }
+
+            std::vector<T> out(a.size());
+            if (m->broadcast) {
+                simd::binaryBroadcast(m->op, a.data(), b[0], out.data(), a.size());
+            } else {
+                simd::binary(m->op, a.data(), b.data(), out.data(), a.size());
+            }
+            return out;
+        }
+
+        std::vector<T> executeArray(const std::string& method, const std::vector<T>& a,
+                                    const std::vector<T>& b) {
+            Result<std::vector<T>> result = callArray(method, a, b);
+            if (!result) result.status().raise();
+            return std::move(result.value());
         }
+
+        // 归约方法：sum/min/max对整个数组归约，结果用Accum<T>表示(min/max可无损表示)；
+        // 元素数达到并行阈值后按块交给线程池，块内使用SIMD，块间再合并
+        static bool isReduceMethod(const std::string& method) {
+            return method == "sum" || method == "min" || method == "max";
+        }
+
+        simd::Accum<T> reduce(const std::string& method, const std::vector<T>& a) {
+            if (method == "sum") {
+                auto parts = mapChunks<simd::Accum<T>>(a.size(), [&](size_t begin, size_t end) {
+                    return simd::sum(a.data() + begin, end - begin);
+                });
+                simd::Accum<T> total = 0;
+                for (auto part : parts) total += part;
+                return total;
+            }
+            if (method != "min" && method != "max") {
+                throw std::runtime_error("Unknown method: " + method);
+            }
+            if (a.empty()) {
+                throw std::invalid_argument(method + " of an empty array");
+            }
+            bool is_max = method == "max";
+            auto parts = mapChunks<T>(a.size(), [&](size_t begin, size_t end) {
+                return is_max ? simd::reduceMax(a.data() + begin, end - begin)
+                              : simd::reduceMin(a.data() + begin, end - begin);
+            });
+            return is_max ? *std::max_element(parts.begin(), parts.end())
+                          : *std::min_element(parts.begin(), parts.end());
+        }
+
+        simd::Accum<T> dot(const std::vector<T>& a, const std::vector<T>& b) {
+            if (a.size() != b.size()) {
+                throw std::invalid_argument("Array length mismatch for dot");
+            }
+            auto parts = mapChunks<simd::Accum<T>>(a.size(), [&](size_t begin, size_t end) {
+                return simd::dot(a.data() + begin, b.data() + begin, end - begin);
+            });
+            simd::Accum<T> total = 0;
+            for (auto part : parts) total += part;
+            return total;
+        }
+
+        // 把[lo, hi)等分为bins个桶，返回每个桶的元素个数
+        std::vector<uint64_t> histogram(const std::vector<T>& a, size_t bins, double lo, double hi) {
+            if (bins == 0 || bins > kMaxHistogramBins || !(lo < hi)) {
+                throw std::invalid_argument("Invalid histogram range");
+            }
+            auto parts = mapChunks<std::vector<uint64_t>>(a.size(), [&](size_t begin, size_t end) {
+                std::vector<uint64_t> counts(bins, 0);
+                simd::histogram(a.data() + begin, end - begin, lo, hi, bins, counts.data());
+                return counts;
+            });
+            std::vector<uint64_t> counts(bins, 0);
+            for (const auto& part : parts) {
+                for (size_t i = 0; i < part.size(); ++i) counts[i] += part[i];
+            }
+            return counts;
+        }
+
+        // 矩阵方法，操作数均为行主序：gemm计算C(m×n) = A(m×k)·B(k×n)，gemv计算y(m) = A(m×n)·x(n)；
+        // 结果写入调用方提供的缓冲区
+        void gemm(size_t m, size_t n, size_t k, const T* a, const T* b, T* c) {
+            simd::gemm(m, n, k, a, b, c, threadPool());
+        }
+
+        void gemv(size_t m, size_t n, const T* a, const T* x, T* y) {
+            simd::gemv(m, n, a, x, y, threadPool());
+        }
+
+        // 元素数不少于该值时才并行，小数组的调度开销大于收益
+        void setParallelThreshold(size_t threshold) { parallel_threshold_ = threshold; }
+
     private:
+        static constexpr size_t kMaxHistogramBins = 1 << 20;
+        static constexpr size_t kMinGrain = 16 * 1024;
+
+        // 把[0, n)切块执行fn(begin, end)，返回每块的结果
+        template <typename R, typename Fn>
+        std::vector<R> mapChunks(size_t n, Fn fn) {
+            ThreadPool* pool = threadPool();
+            if (!pool || n < parallel_threshold_) {
+                return std::vector<R>{fn(0, n)};
+            }
+            // 每个线程分到约4块，兼顾负载均衡和合并开销
+            size_t grain = std::max(kMinGrain, n / ((pool->size() + 1) * 4) + 1);
+            std::vector<R> parts((n + grain - 1) / grain);
+            parallelFor(pool, n, grain, [&](size_t chunk, size_t begin, size_t end) {
+                parts[chunk] = fn(begin, end);
+            });
+            return parts;
+        }
+
+        size_t parallel_threshold_ = 256 * 1024;
+
         T add(T a, T b) { return a + b; }
         T sub(T a, T b) { return a - b; }
         T mul(T a, T b) { return a * b; }
-        T div(T a, T b) { return a / b; }        
+        T div(T a, T b) { return a / b; }
+
+        // 整数除零和有符号最小值除以-1(商溢出)都会使整个进程收到SIGFPE，必须在计算前拦截
+        static bool hasZeroDivisor(const T* divisors, size_t n) {
+            return std::is_integral<T>::value && std::find(divisors, divisors + n, T(0)) != divisors + n;
+        }
+
+        // broadcast时所有被除数都除以divisors[0]
+        static bool overflowsDivision(const T* dividends, size_t n, const T* divisors, bool broadcast) {
+            if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+                for (size_t i = 0; i < n; ++i) {
+                    if (dividends[i] == std::numeric_limits<T>::min() && divisors[broadcast ? 0 : i] == T(-1)) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        static Status divisionByZero() { return Status(ErrorCode::DomainError, "Division by zero"); }
+        static Status divisionOverflow() { return Status(ErrorCode::DomainError, "Integer overflow in division"); }
+
+        struct ArrayMethod {
+            simd::BinaryOp op;
+            bool broadcast;
+        };
+
+        static const ArrayMethod* findArrayMethod(const std::string& method) {
+            static const std::unordered_map<std::string, ArrayMethod> methods = {
+                {"vadd", {simd::BinaryOp::Add, false}}, {"vadds", {simd::BinaryOp::Add, true}},
+                {"vsub", {simd::BinaryOp::Sub, false}}, {"vsubs", {simd::BinaryOp::Sub, true}},
+                {"vmul", {simd::BinaryOp::Mul, false}}, {"vmuls", {simd::BinaryOp::Mul, true}},
+                {"vdiv", {simd::BinaryOp::Div, false}}, {"vdivs", {simd::BinaryOp::Div, true}},
+            };
+            auto it = methods.find(method);
+            return it == methods.end() ? nullptr : &it->second;
+        }
 };
 
 } // namespace trpc 
\ No newline at end of file
@@ -0,0 +1,486 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TRPC_SIMD_X86 1
+#define TRPC_TARGET_SSE __attribute__((target("sse4.1")))
+#define TRPC_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+/*
+    SIMD计算内核
+    +运行时检测CPU支持的指令集(AVX2 / SSE4.1 / 标量)，一次检测后缓存
+    +int32、float、double有向量化实现，其他类型走标量实现
+    +逐元素运算有AVX2和SSE4.1两套实现；归约只实现了AVX2，其余走标量实现
+    +环境变量TRPC_SIMD=scalar|sse|avx2可把指令集降级，便于对比测试
+*/
+namespace trpc {
+namespace simd {
+
+enum class Isa { Scalar, SSE, AVX2 };
+
+inline Isa detectIsa() {
+    Isa isa = Isa::Scalar;
+#ifdef TRPC_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        isa = Isa::AVX2;
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        isa = Isa::SSE;
+    }
+#endif
+    const char* forced = getenv("TRPC_SIMD");
+    if (forced) {
+        Isa wanted = strcmp(forced, "scalar") == 0 ? Isa::Scalar
+                   : strcmp(forced, "sse") == 0 ? Isa::SSE : Isa::AVX2;
+        if (wanted < isa) isa = wanted;
+    }
+    return isa;
+}
+
+inline Isa activeIsa() {
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+inline const char* isaName(Isa isa) {
+    switch (isa) {
+        case Isa::AVX2: return "avx2";
+        case Isa::SSE: return "sse4.1";
+        default: return "scalar";
+    }
+}
+
+enum class BinaryOp { Add, Sub, Mul, Div };
+
+namespace detail {
+
+template <BinaryOp kOp, typename T>
+inline T apply(T a, T b) {
+    if (kOp == BinaryOp::Add) return a + b;
+    if (kOp == BinaryOp::Sub) return a - b;
+    if (kOp == BinaryOp::Mul) return a * b;
+    return a / b;
+}
+
+// stride为0时b是标量，否则为与a等长的数组
+template <BinaryOp kOp, typename T>
+inline void binaryScalar(const T* a, const T* b, size_t stride, T* out, size_t n, size_t i = 0) {
+    for (; i < n; ++i) {
+        out[i] = apply<kOp>(a[i], b[i * stride]);
+    }
+}
+
+#ifdef TRPC_SIMD_X86
+
+struct Avx2F32 {
+    using T = float;
+    using V = __m256;
+    static constexpr size_t kWidth = 8;
+    TRPC_TARGET_AVX2 static V load(const T* p) { return _mm256_loadu_ps(p); }
+    TRPC_TARGET_AVX2 static void store(T* p, V v) { _mm256_storeu_ps(p, v); }
+    TRPC_TARGET_AVX2 static V set1(T x) { return _mm256_set1_ps(x); }
+    TRPC_TARGET_AVX2 static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    TRPC_TARGET_AVX2 static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    TRPC_TARGET_AVX2 static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    TRPC_TARGET_AVX2 static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    TRPC_TARGET_AVX2 static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+};
+
+struct Avx2F64 {
+    using T = double;
+    using V = __m256d;
+    static constexpr size_t kWidth = 4;
+    TRPC_TARGET_AVX2 static V load(const T* p) { return _mm256_loadu_pd(p); }
+    TRPC_TARGET_AVX2 static void store(T* p, V v) { _mm256_storeu_pd(p, v); }
+    TRPC_TARGET_AVX2 static V set1(T x) { return _mm256_set1_pd(x); }
+    TRPC_TARGET_AVX2 static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    TRPC_TARGET_AVX2 static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    TRPC_TARGET_AVX2 static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    TRPC_TARGET_AVX2 static V div(V a, V b) { return _mm256_div_pd(a, b); }
+    TRPC_TARGET_AVX2 static V fmadd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+};
+
+struct Avx2I32 {
+    using T = int32_t;
+    using V = __m256i;
+    static constexpr size_t kWidth = 8;
+    TRPC_TARGET_AVX2 static V load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const V*>(p)); }
+    TRPC_TARGET_AVX2 static void store(T* p, V v) { _mm256_storeu_si256(reinterpret_cast<V*>(p), v); }
+    TRPC_TARGET_AVX2 static V set1(T x) { return _mm256_set1_epi32(x); }
+    TRPC_TARGET_AVX2 static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+    TRPC_TARGET_AVX2 static V sub(V a, V b) { return _mm256_sub_epi32(a, b); }
+    TRPC_TARGET_AVX2 static V mul(V a, V b) { return _mm256_mullo_epi32(a, b); }
+    // 没有整数除法指令：转成double相除再截断，对int32范围内的商是精确的
+    TRPC_TARGET_AVX2 static V div(V a, V b) {
+        __m256d lo = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)),
+                                   _mm256_cvtepi32_pd(_mm256_castsi256_si128(b)));
+        __m256d hi = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)),
+                                   _mm256_cvtepi32_pd(_mm256_extracti128_si256(b, 1)));
+        return _mm256_set_m128i(_mm256_cvttpd_epi32(hi), _mm256_cvttpd_epi32(lo));
+    }
+    TRPC_TARGET_AVX2 static V fmadd(V a, V b, V c) { return _mm256_add_epi32(_mm256_mullo_epi32(a, b), c); }
+};
+
+struct SseF32 {
+    using T = float;
+    using V = __m128;
+    static constexpr size_t kWidth = 4;
+    TRPC_TARGET_SSE static V load(const T* p) { return _mm_loadu_ps(p); }
+    TRPC_TARGET_SSE static void store(T* p, V v) { _mm_storeu_ps(p, v); }
+    TRPC_TARGET_SSE static V set1(T x) { return _mm_set1_ps(x); }
+    TRPC_TARGET_SSE static V add(V a, V b) { return _mm_add_ps(a, b); }
+    TRPC_TARGET_SSE static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    TRPC_TARGET_SSE static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    TRPC_TARGET_SSE static V div(V a, V b) { return _mm_div_ps(a, b); }
+};
+
+struct SseF64 {
+    using T = double;
+    using V = __m128d;
+    static constexpr size_t kWidth = 2;
+    TRPC_TARGET_SSE static V load(const T* p) { return _mm_loadu_pd(p); }
+    TRPC_TARGET_SSE static void store(T* p, V v) { _mm_storeu_pd(p, v); }
+    TRPC_TARGET_SSE static V set1(T x) { return _mm_set1_pd(x); }
+    TRPC_TARGET_SSE static V add(V a, V b) { return _mm_add_pd(a, b); }
+    TRPC_TARGET_SSE static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    TRPC_TARGET_SSE static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    TRPC_TARGET_SSE static V div(V a, V b) { return _mm_div_pd(a, b); }
+};
+
+struct SseI32 {
+    using T = int32_t;
+    using V = __m128i;
+    static constexpr size_t kWidth = 4;
+    TRPC_TARGET_SSE static V load(const T* p) { return _mm_loadu_si128(reinterpret_cast<const V*>(p)); }
+    TRPC_TARGET_SSE static void store(T* p, V v) { _mm_storeu_si128(reinterpret_cast<V*>(p), v); }
+    TRPC_TARGET_SSE static V set1(T x) { return _mm_set1_epi32(x); }
+    TRPC_TARGET_SSE static V add(V a, V b) { return _mm_add_epi32(a, b); }
+    TRPC_TARGET_SSE static V sub(V a, V b) { return _mm_sub_epi32(a, b); }
+    TRPC_TARGET_SSE static V mul(V a, V b) { return _mm_mullo_epi32(a, b); }
+    TRPC_TARGET_SSE static V div(V a, V b) {
+        __m128d lo = _mm_div_pd(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(b));
+        __m128d hi = _mm_div_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(a, 0xEE)),
+                                _mm_cvtepi32_pd(_mm_shuffle_epi32(b, 0xEE)));
+        return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+    }
+};
+
+// 向量主循环，尾部不足一个向量的元素走标量实现；
+// 每个指令集各生成一份，保证低级指令集的路径里不会混入高级指令
+#define TRPC_SIMD_BINARY_LOOP(TARGET, NAME)                                                  \
+    template <BinaryOp kOp, class Ops>                                                       \
+    TARGET inline typename Ops::V NAME##Apply(typename Ops::V a, typename Ops::V b) {        \
+        if (kOp == BinaryOp::Add) return Ops::add(a, b);                                     \
+        if (kOp == BinaryOp::Sub) return Ops::sub(a, b);                                     \
+        if (kOp == BinaryOp::Mul) return Ops::mul(a, b);                                     \
+        return Ops::div(a, b);                                                               \
+    }                                                                                        \
+    template <BinaryOp kOp, class Ops>                                                       \
+    TARGET void NAME(const typename Ops::T* a, const typename Ops::T* b, size_t stride,      \
+                     typename Ops::T* out, size_t n) {                                       \
+        constexpr size_t W = Ops::kWidth;                                                    \
+        size_t i = 0;                                                                        \
+        if (stride == 0) {                                                                   \
+            typename Ops::V vb = Ops::set1(*b);                                              \
+            for (; i + W <= n; i += W) {                                                     \
+                Ops::store(out + i, NAME##Apply<kOp, Ops>(Ops::load(a + i), vb));            \
+            }                                                                                \
+        } else {                                                                             \
+            for (; i + W <= n; i += W) {                                                     \
+                Ops::store(out + i, NAME##Apply<kOp, Ops>(Ops::load(a + i), Ops::load(b + i))); \
+            }                                                                                \
+        }                                                                                    \
+        binaryScalar<kOp>(a, b, stride, out, n, i);                                          \
+    }
+
+TRPC_SIMD_BINARY_LOOP(TRPC_TARGET_AVX2, binaryAvx2)
+TRPC_SIMD_BINARY_LOOP(TRPC_TARGET_SSE, binarySse)
+
+#undef TRPC_SIMD_BINARY_LOOP
+
+template <typename T> struct IsaOps { using Avx2 = void; using Sse = void; };
+template <> struct IsaOps<float> { using Avx2 = Avx2F32; using Sse = SseF32; };
+template <> struct IsaOps<double> { using Avx2 = Avx2F64; using Sse = SseF64; };
+template <> struct IsaOps<int32_t> { using Avx2 = Avx2I32; using Sse = SseI32; };
+
+#endif // TRPC_SIMD_X86
+
+template <BinaryOp kOp, typename T>
+inline void binaryDispatch(const T* a, const T* b, size_t stride, T* out, size_t n) {
+#ifdef TRPC_SIMD_X86
+    using Avx2 = typename IsaOps<T>::Avx2;
+    using Sse = typename IsaOps<T>::Sse;
+    if constexpr (!std::is_void<Avx2>::value) {
+        switch (activeIsa()) {
+            case Isa::AVX2: binaryAvx2<kOp, Avx2>(a, b, stride, out, n); return;
+            case Isa::SSE: binarySse<kOp, Sse>(a, b, stride, out, n); return;
+            default: break;
+        }
+    }
+#endif
+    binaryScalar<kOp>(a, b, stride, out, n);
+}
+
+} // namespace detail
+
+// out[i] = a[i] op b[i]
+template <typename T>
+inline void binary(BinaryOp op, const T* a, const T* b, T* out, size_t n) {
+    switch (op) {
+        case BinaryOp::Add: detail::binaryDispatch<BinaryOp::Add>(a, b, 1, out, n); break;
+        case BinaryOp::Sub: detail::binaryDispatch<BinaryOp::Sub>(a, b, 1, out, n); break;
+        case BinaryOp::Mul: detail::binaryDispatch<BinaryOp::Mul>(a, b, 1, out, n); break;
+        case BinaryOp::Div: detail::binaryDispatch<BinaryOp::Div>(a, b, 1, out, n); break;
+    }
+}
+
+// out[i] = a[i] op b
+template <typename T>
+inline void binaryBroadcast(BinaryOp op, const T* a, T b, T* out, size_t n) {
+    switch (op) {
+        case BinaryOp::Add: detail::binaryDispatch<BinaryOp::Add>(a, &b, 0, out, n); break;
+        case BinaryOp::Sub: detail::binaryDispatch<BinaryOp::Sub>(a, &b, 0, out, n); break;
+        case BinaryOp::Mul: detail::binaryDispatch<BinaryOp::Mul>(a, &b, 0, out, n); break;
+        case BinaryOp::Div: detail::binaryDispatch<BinaryOp::Div>(a, &b, 0, out, n); break;
+    }
+}
+
+// 归约的累加类型：整数用int64避免溢出，浮点用double减小误差
+template <typename T>
+using Accum = typename std::conditional<std::is_integral<T>::value, int64_t, double>::type;
+
+namespace detail {
+
+template <typename T>
+constexpr bool kHasVectorKernel = std::is_same<T, int32_t>::value || std::is_same<T, float>::value
+                                  || std::is_same<T, double>::value;
+
+template <bool kMax, typename T>
+inline T pick(T a, T b) {
+    return (kMax ? b > a : b < a) ? b : a;
+}
+
+template <typename T>
+inline Accum<T> sumScalar(const T* a, size_t n) {
+    Accum<T> acc = 0;
+    for (size_t i = 0; i < n; ++i) acc += a[i];
+    return acc;
+}
+
+template <typename T>
+inline Accum<T> dotScalar(const T* a, const T* b, size_t n) {
+    Accum<T> acc = 0;
+    for (size_t i = 0; i < n; ++i) acc += static_cast<Accum<T>>(a[i]) * b[i];
+    return acc;
+}
+
+template <bool kMax, typename T>
+inline T extremeScalar(const T* a, size_t n) {
+    T best = a[0];
+    for (size_t i = 1; i < n; ++i) {
+        if (kMax ? a[i] > best : a[i] < best) best = a[i];
+    }
+    return best;
+}
+
+#ifdef TRPC_SIMD_X86
+
+// 水平求和
+TRPC_TARGET_AVX2 inline int64_t hsum(__m256i v) {
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+TRPC_TARGET_AVX2 inline double hsum(__m256d v) {
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, v);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+// 每次处理8个int32，拆成两组符号扩展到int64后累加
+TRPC_TARGET_AVX2 inline int64_t sumAvx2(const int32_t* a, size_t n) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    return hsum(_mm256_add_epi64(acc0, acc1)) + sumScalar(a + i, n - i);
+}
+
+TRPC_TARGET_AVX2 inline double sumAvx2(const float* a, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(a + i);
+        acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+        acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+    }
+    return hsum(_mm256_add_pd(acc0, acc1)) + sumScalar(a + i, n - i);
+}
+
+TRPC_TARGET_AVX2 inline double sumAvx2(const double* a, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(a + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(a + i + 4));
+    }
+    return hsum(_mm256_add_pd(acc0, acc1)) + sumScalar(a + i, n - i);
+}
+
+// _mm256_mul_epi32取每个64位通道的低32位做有符号乘法，得到完整的64位乘积
+TRPC_TARGET_AVX2 inline int64_t dotAvx2(const int32_t* a, const int32_t* b, size_t n) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        acc0 = _mm256_add_epi64(acc0, _mm256_mul_epi32(
+            _mm256_cvtepi32_epi64(_mm256_castsi256_si128(va)),
+            _mm256_cvtepi32_epi64(_mm256_castsi256_si128(vb))));
+        acc1 = _mm256_add_epi64(acc1, _mm256_mul_epi32(
+            _mm256_cvtepi32_epi64(_mm256_extracti128_si256(va, 1)),
+            _mm256_cvtepi32_epi64(_mm256_extracti128_si256(vb, 1))));
+    }
+    return hsum(_mm256_add_epi64(acc0, acc1)) + dotScalar(a + i, b + i, n - i);
+}
+
+TRPC_TARGET_AVX2 inline double dotAvx2(const float* a, const float* b, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 va = _mm256_loadu_ps(a + i);
+        __m256 vb = _mm256_loadu_ps(b + i);
+        acc0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(va)),
+                               _mm256_cvtps_pd(_mm256_castps256_ps128(vb)), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(va, 1)),
+                               _mm256_cvtps_pd(_mm256_extractf128_ps(vb, 1)), acc1);
+    }
+    return hsum(_mm256_add_pd(acc0, acc1)) + dotScalar(a + i, b + i, n - i);
+}
+
+TRPC_TARGET_AVX2 inline double dotAvx2(const double* a, const double* b, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), acc1);
+    }
+    return hsum(_mm256_add_pd(acc0, acc1)) + dotScalar(a + i, b + i, n - i);
+}
+
+template <bool kMax>
+TRPC_TARGET_AVX2 inline int32_t extremeAvx2(const int32_t* a, size_t n) {
+    if (n < 8) return extremeScalar<kMax>(a, n);
+    __m256i best = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        best = kMax ? _mm256_max_epi32(best, v) : _mm256_min_epi32(best, v);
+    }
+    alignas(32) int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), best);
+    int32_t result = extremeScalar<kMax>(lanes, 8);
+    return i < n ? pick<kMax>(result, extremeScalar<kMax>(a + i, n - i)) : result;
+}
+
+template <bool kMax>
+TRPC_TARGET_AVX2 inline float extremeAvx2(const float* a, size_t n) {
+    if (n < 8) return extremeScalar<kMax>(a, n);
+    __m256 best = _mm256_loadu_ps(a);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(a + i);
+        best = kMax ? _mm256_max_ps(best, v) : _mm256_min_ps(best, v);
+    }
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, best);
+    float result = extremeScalar<kMax>(lanes, 8);
+    return i < n ? pick<kMax>(result, extremeScalar<kMax>(a + i, n - i)) : result;
+}
+
+template <bool kMax>
+TRPC_TARGET_AVX2 inline double extremeAvx2(const double* a, size_t n) {
+    if (n < 4) return extremeScalar<kMax>(a, n);
+    __m256d best = _mm256_loadu_pd(a);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(a + i);
+        best = kMax ? _mm256_max_pd(best, v) : _mm256_min_pd(best, v);
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, best);
+    double result = extremeScalar<kMax>(lanes, 4);
+    return i < n ? pick<kMax>(result, extremeScalar<kMax>(a + i, n - i)) : result;
+}
+
+#endif // TRPC_SIMD_X86
+
+} // namespace detail
+
+template <typename T>
+inline Accum<T> sum(const T* a, size_t n) {
+#ifdef TRPC_SIMD_X86
+    if constexpr (detail::kHasVectorKernel<T>) {
+        if (activeIsa() == Isa::AVX2) return detail::sumAvx2(a, n);
+    }
+#endif
+    return detail::sumScalar(a, n);
+}
+
+template <typename T>
+inline Accum<T> dot(const T* a, const T* b, size_t n) {
+#ifdef TRPC_SIMD_X86
+    if constexpr (detail::kHasVectorKernel<T>) {
+        if (activeIsa() == Isa::AVX2) return detail::dotAvx2(a, b, n);
+    }
+#endif
+    return detail::dotScalar(a, b, n);
+}
+
+// n必须大于0
+template <typename T>
+inline T reduceMin(const T* a, size_t n) {
+#ifdef TRPC_SIMD_X86
+    if constexpr (detail::kHasVectorKernel<T>) {
+        if (activeIsa() == Isa::AVX2) return detail::extremeAvx2<false>(a, n);
+    }
+#endif
+    return detail::extremeScalar<false>(a, n);
+}
+
+template <typename T>
+inline T reduceMax(const T* a, size_t n) {
+#ifdef TRPC_SIMD_X86
+    if constexpr (detail::kHasVectorKernel<T>) {
+        if (activeIsa() == Isa::AVX2) return detail::extremeAvx2<true>(a, n);
+    }
+#endif
+    return detail::extremeScalar<true>(a, n);
+}
+
+// 把[lo, hi)等分为bins个桶并累加到counts，区间外的元素不计数
+template <typename T>
+inline void histogram(const T* a, size_t n, double lo, double hi, size_t bins, uint64_t* counts) {
+    double scale = bins / (hi - lo);
+    for (size_t i = 0; i < n; ++i) {
+        double x = static_cast<double>(a[i]);
+        if (x >= lo && x < hi) {
+            size_t bin = static_cast<size_t>((x - lo) * scale);
+            counts[bin < bins ? bin : bins - 1]++;
+        }
+    }
+}
+
+} // namespace simd
+} // namespace trpc
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <optional>
+#include <stdexcept>
+
+#include "json.hpp"
+
+/*
+    错误码与结果类型
+    +客户端造成的预期失败(格式错误、服务或方法不存在、参数不对、除零)用Status/Result<T>沿调用链返回，
+     不经过异常展开；异常只留给真正的意外(如内存不足、服务实现内部的错误)
+    +错误响应为{"error": 描述, "code": 错误码}，错误码的数值是协议的一部分，只能追加不能改动
+    +客户端收到错误时抛出StatusError，可以按code()区分错误类型
+*/
+namespace trpc {
+
+enum class ErrorCode : int {
+    Ok = 0,
+    BadRequest = 1,         // 请求无法解析：JSON格式错误、缺少字段、帧内容不完整
+    UnknownService = 2,
+    UnknownMethod = 3,
+    InvalidArgument = 4,    // 参数个数、类型或尺寸不对
+    DomainError = 5,        // 参数合法但无法计算，如整数除零
+    Internal = 6            // 服务内部的意外错误
+};
+
+inline const char* errorCodeName(ErrorCode code) {
+    switch (code) {
+        case ErrorCode::Ok: return "OK";
+        case ErrorCode::BadRequest: return "BAD_REQUEST";
+        case ErrorCode::UnknownService: return "UNKNOWN_SERVICE";
+        case ErrorCode::UnknownMethod: return "UNKNOWN_METHOD";
+        case ErrorCode::InvalidArgument: return "INVALID_ARGUMENT";
+        case ErrorCode::DomainError: return "DOMAIN_ERROR";
+        case ErrorCode::Internal: return "INTERNAL";
+    }
+    return "UNKNOWN";
+}
+
+// 未知的数值(如更新的服务端追加的错误码)按Internal处理
+inline ErrorCode errorCodeFromInt(int value) {
+    return value >= 0 && value <= static_cast<int>(ErrorCode::Internal) ? static_cast<ErrorCode>(value)
+                                                                      : ErrorCode::Internal;
+}
+
+class Status {
+    public:
+        Status() : code_(ErrorCode::Ok) {}
+        Status(ErrorCode code, std::string message) : code_(code), message_(std::move(message)) {}
+
+        bool ok() const { return code_ == ErrorCode::Ok; }
+        ErrorCode code() const { return code_; }
+        const std::string& message() const { return message_; }
+
+        // 转换为与错误码对应的标准异常，供仍以异常报告错误的接口使用
+        [[noreturn]] void raise() const {
+            switch (code_) {
+                case ErrorCode::InvalidArgument: throw std::invalid_argument(message_);
+                case ErrorCode::DomainError: throw std::domain_error(message_);
+                default: throw std::runtime_error(message_);
+            }
+        }
+
+    private:
+        ErrorCode code_;
+        std::string message_;
+};
+
+// 成功时持有T，失败时持有非Ok的Status
+template <typename T>
+class Result {
+    public:
+        Result(T value) : value_(std::move(value)) {}
+        Result(Status status) : status_(std::move(status)) {}
+
+        bool ok() const { return value_.has_value(); }
+        explicit operator bool() const { return ok(); }
+        const Status& status() const { return status_; }
+
+        T& value() { return *value_; }
+        const T& value() const { return *value_; }
+
+    private:
+        std::optional<T> value_;
+        Status status_;
+};
+
+// 客户端收到错误响应时抛出；服务端也用它在只能抛异常的回调(如DAG节点求值)中携带错误码
+class StatusError : public std::runtime_error {
+    public:
+        explicit StatusError(Status status)
+            : std::runtime_error(status.message()), status_(std::move(status)) {}
+
+        ErrorCode code() const { return status_.code(); }
+        const Status& status() const { return status_; }
+
+    private:
+        Status status_;
+};
+
+// 服务实现或参数转换抛出的异常按类型映射为错误码
+inline Status statusFromException(const std::exception& e) {
+    if (auto error = dynamic_cast<const StatusError*>(&e)) return error->status();
+    if (dynamic_cast<const nlohmann::json::parse_error*>(&e)) return Status(ErrorCode::BadRequest, e.what());
+    if (dynamic_cast<const nlohmann::json::exception*>(&e) || dynamic_cast<const std::invalid_argument*>(&e)
+        || dynamic_cast<const std::out_of_range*>(&e) || dynamic_cast<const std::length_error*>(&e)) {
+        return Status(ErrorCode::InvalidArgument, e.what());
+    }
+    if (dynamic_cast<const std::domain_error*>(&e)) return Status(ErrorCode::DomainError, e.what());
+    return Status(ErrorCode::Internal, e.what());
+}
+
+} // namespace trpc
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <stdexcept>
+
+/*
+    线程池
+    +ThreadPool ： 固定大小的工作线程，处理Server分发的请求
+    +parallelFor ： 把一段区间切块后由线程池和调用线程共同完成
+*/
+namespace trpc {
+
+class ThreadPool {
+    public:
+        ThreadPool(int numThreads) : stop_(false) {
+            for (int i = 0; i < numThreads; ++i) {
+                threads_.emplace_back([this] {
+                    while (true) {
+                        std::function<void()> task;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex_);
+                            condition_.wait(lock, [this] {
+                                return stop_ || !tasks_.empty();
+                            });
+                            if (stop_ && tasks_.empty()) return;
+                            task = std::move(tasks_.front());
+                            tasks_.pop();
+                        }
+                        task();
+                    }
+                });
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            condition_.notify_all();
+            for (auto& thread : threads_) {
+                thread.join();
+            }
+        }
+
+        size_t size() const { return threads_.size(); }
+
+        void addTask(std::function<void()> task) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (stop_) {
+                    throw std::runtime_error("ThreadPool is stopped");
+                }
+                tasks_.emplace(std::move(task));
+            }
+            condition_.notify_one();
+        }
+        
+    private:
+        std::vector<std::thread> threads_;
+        std::queue<std::function<void()>> tasks_;
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        bool stop_;
+};
+
+// 把[0, n)按grain切块，body(chunk, begin, end)在线程池和调用线程上并行执行，
+// 所有块完成后返回，第一个异常会在调用线程重新抛出。
+// 调用线程自己也领取块，并且只等待已被领取、正在执行的块，
+// 因此即使在线程池的工作线程中调用、线程池已满载也不会死锁。
+inline void parallelFor(ThreadPool* pool, size_t n, size_t grain,
+                        const std::function<void(size_t, size_t, size_t)>& body) {
+    if (grain == 0) grain = 1;
+    size_t chunks = (n + grain - 1) / grain;
+    if (!pool || pool->size() == 0 || chunks <= 1) {
+        if (n > 0) body(0, 0, n);
+        return;
+    }
+
+    struct State {
+        std::atomic<size_t> next{0};
+        size_t done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+    const auto* body_ptr = &body;
+
+    // 辅助任务可能在parallelFor返回后才被调度，此时领不到块，不会再访问body
+    auto work = [state, body_ptr, chunks, grain, n]() {
+        size_t finished = 0;
+        std::exception_ptr error;
+        size_t chunk;
+        while ((chunk = state->next.fetch_add(1, std::memory_order_relaxed)) < chunks) {
+            size_t begin = chunk * grain;
+            size_t end = std::min(n, begin + grain);
+            try {
+                (*body_ptr)(chunk, begin, end);
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+            ++finished;
+        }
+        if (finished == 0) return;
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (error && !state->error) state->error = error;
+        state->done += finished;
+        if (state->done == chunks) state->cv.notify_all();
+    };
+
+    size_t helpers = std::min(pool->size(), chunks - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        pool->addTask(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&] { return state->done == chunks; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+} // namespace trpc
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <limits>
+#include <time.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/*
+    定时器
+    +TimingWheel ： 分层时间轮，按tick计时，插入和取消均为O(1)
+    +TimerQueue ： timerfd + 时间轮，供Reactor在事件循环中驱动
+*/
+namespace trpc {
+
+// 定时器句柄：高32位为代数(generation)，低32位为节点下标，0表示无效
+using TimerId = uint64_t;
+constexpr TimerId kInvalidTimerId = 0;
+
+class TimingWheel {
+    public:
+        using Callback = std::function<void()>;
+
+        // 第0级256个槽，第1~3级各64个槽，共可表示2^26个tick
+        static constexpr int kLevel0Bits = 8;
+        static constexpr int kLevelNBits = 6;
+        static constexpr int kLevels = 4;
+        static constexpr uint64_t kLevel0Size = 1u << kLevel0Bits;
+        static constexpr uint64_t kLevelNSize = 1u << kLevelNBits;
+        static constexpr uint64_t kMaxSpan = 1ull << (kLevel0Bits + (kLevels - 1) * kLevelNBits);
+
+        TimingWheel() : base_(0), size_(0), free_head_(kNil) {
+            // 每个槽以及待执行链表各占一个哨兵节点
+            nodes_.resize(kNodeBase);
+            for (uint32_t i = 0; i < kNodeBase; ++i) {
+                nodes_[i].prev = nodes_[i].next = i;
+            }
+        }
+
+        // 在绝对tick处触发；interval大于0时为周期定时器
+        TimerId scheduleAt(uint64_t expire, uint64_t interval, Callback callback) {
+            if (expire < base_) expire = base_;
+
+            uint32_t index = allocNode();
+            Node& node = nodes_[index];
+            node.expire = expire;
+            node.interval = interval;
+            node.callback = std::move(callback);
+            node.active = true;
+            insert(index);
+            ++size_;
+            return (static_cast<uint64_t>(node.generation) << 32) | index;
+        }
+
+        bool cancel(TimerId id) {
+            uint32_t index = static_cast<uint32_t>(id);
+            uint32_t generation = static_cast<uint32_t>(id >> 32);
+            if (index < kNodeBase || index >= nodes_.size()) return false;
+            Node& node = nodes_[index];
+            if (!node.active || node.generation != generation) return false;
+            unlink(index);
+            freeNode(index);
+            --size_;
+            return true;
+        }
+
+        // 推进到target(含)，依次触发到期的定时器
+        void advanceTo(uint64_t target) {
+            while (base_ <= target) {
+                if (size_ == 0) {
+                    base_ = target + 1;
+                    return;
+                }
+                tick();
+            }
+        }
+
+        // 下一次需要推进的绝对tick，空时返回UINT64_MAX
+        uint64_t nextExpiry() const {
+            if (size_ == 0) return std::numeric_limits<uint64_t>::max();
+            // 只扫描到第0级本轮结束为止，之后需要级联，届时再重新计算
+            uint64_t boundary = (base_ | (kLevel0Size - 1)) + 1;
+            for (uint64_t t = base_; t < boundary; ++t) {
+                uint32_t slot = static_cast<uint32_t>(t & (kLevel0Size - 1));
+                if (nodes_[slot].next != slot) return t;
+            }
+            return boundary;
+        }
+
+        uint64_t base() const { return base_; }
+        size_t size() const { return size_; }
+
+    private:
+        static constexpr uint32_t kNil = std::numeric_limits<uint32_t>::max();
+        static constexpr uint32_t kSlotCount = kLevel0Size + (kLevels - 1) * kLevelNSize;
+        static constexpr uint32_t kPending = kSlotCount;
+        static constexpr uint32_t kNodeBase = kSlotCount + 1;
+
+        struct Node {
+            uint32_t prev = 0;
+            uint32_t next = 0;
+            uint32_t generation = 1;
+            bool active = false;
+            uint64_t expire = 0;
+            uint64_t interval = 0;
+            Callback callback;
+        };
+
+        uint32_t allocNode() {
+            if (free_head_ != kNil) {
+                uint32_t index = free_head_;
+                free_head_ = nodes_[index].next;
+                return index;
+            }
+            nodes_.emplace_back();
+            return static_cast<uint32_t>(nodes_.size() - 1);
+        }
+
+        void freeNode(uint32_t index) {
+            Node& node = nodes_[index];
+            node.active = false;
+            node.callback = nullptr;
+            // 代数递增使旧句柄失效，跳过0以保证句柄永不为kInvalidTimerId
+            if (++node.generation == 0) node.generation = 1;
+            node.next = free_head_;
+            free_head_ = index;
+        }
+
+        uint32_t slotFor(uint64_t expire) const {
+            uint64_t delta = expire - base_;
+            if (delta < kLevel0Size) {
+                return static_cast<uint32_t>(expire & (kLevel0Size - 1));
+            }
+            if (delta >= kMaxSpan) {
+                // 超出范围的先挂在最高级，级联时再重新计算
+                expire = base_ + kMaxSpan - 1;
+            }
+            int shift = kLevel0Bits;
+            for (int level = 1; level < kLevels; ++level, shift += kLevelNBits) {
+                if (level == kLevels - 1 || expire - base_ < (1ull << (shift + kLevelNBits))) {
+                    return static_cast<uint32_t>(kLevel0Size + (level - 1) * kLevelNSize
+                                                 + ((expire >> shift) & (kLevelNSize - 1)));
+                }
+            }
+            return 0;
+        }
+
+        void insert(uint32_t index) {
+            linkBefore(slotFor(nodes_[index].expire), index);
+        }
+
+        void linkBefore(uint32_t head, uint32_t index) {
+            Node& node = nodes_[index];
+            node.next = head;
+            node.prev = nodes_[head].prev;
+            nodes_[node.prev].next = index;
+            nodes_[head].prev = index;
+        }
+
+        void unlink(uint32_t index) {
+            Node& node = nodes_[index];
+            nodes_[node.prev].next = node.next;
+            nodes_[node.next].prev = node.prev;
+            node.prev = node.next = index;
+        }
+
+        // 把整个槽摘到待执行链表上，回调中新插入的定时器不会进入本轮
+        void spliceToPending(uint32_t slot) {
+            if (nodes_[slot].next == slot) return;
+            uint32_t first = nodes_[slot].next;
+            uint32_t last = nodes_[slot].prev;
+            nodes_[slot].prev = nodes_[slot].next = slot;
+            nodes_[kPending].next = first;
+            nodes_[kPending].prev = last;
+            nodes_[first].prev = kPending;
+            nodes_[last].next = kPending;
+        }
+
+        // 第level级当前槽重新散列到更低级
+        bool cascade(int level) {
+            int shift = kLevel0Bits + (level - 1) * kLevelNBits;
+            uint32_t index = static_cast<uint32_t>((base_ >> shift) & (kLevelNSize - 1));
+            spliceToPending(kLevel0Size + (level - 1) * kLevelNSize + index);
+            while (nodes_[kPending].next != kPending) {
+                uint32_t node = nodes_[kPending].next;
+                unlink(node);
+                insert(node);
+            }
+            return index == 0;
+        }
+
+        void tick() {
+            uint64_t now = base_;
+            uint32_t slot = static_cast<uint32_t>(now & (kLevel0Size - 1));
+            if (slot == 0) {
+                for (int level = 1; level < kLevels && cascade(level); ++level) {}
+            }
+            ++base_;
+
+            spliceToPending(slot);
+            while (nodes_[kPending].next != kPending) {
+                uint32_t index = nodes_[kPending].next;
+                unlink(index);
+                Node& node = nodes_[index];
+                if (node.expire > now) {
+                    insert(index);
+                    continue;
+                }
+                if (node.interval == 0) {
+                    Callback callback = std::move(node.callback);
+                    freeNode(index);
+                    --size_;
+                    callback();
+                } else {
+                    // 周期定时器先重新挂回去，回调内可以安全地取消自身
+                    node.expire = now + node.interval;
+                    insert(index);
+                    Callback callback = node.callback;
+                    callback();
+                }
+            }
+        }
+
+        std::vector<Node> nodes_;
+        uint64_t base_;
+        size_t size_;
+        uint32_t free_head_;
+};
+
+class TimerQueue {
+    public:
+        using Callback = TimingWheel::Callback;
+
+        explicit TimerQueue(std::chrono::milliseconds tick = std::chrono::milliseconds(1))
+            : tick_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(tick).count()),
+              armed_tick_(std::numeric_limits<uint64_t>::max()) {
+            if (tick_ns_ <= 0) {
+                throw std::invalid_argument("Timer tick must be positive");
+            }
+            timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (timer_fd_ == -1) {
+                throw std::runtime_error("Failed to create timerfd");
+            }
+            start_ns_ = monotonicNs();
+        }
+
+        ~TimerQueue() {
+            if (timer_fd_ != -1) {
+                close(timer_fd_);
+            }
+        }
+
+        TimerQueue(const TimerQueue&) = delete;
+        TimerQueue& operator=(const TimerQueue&) = delete;
+
+        int getFd() const { return timer_fd_; }
+
+        TimerId runAfter(std::chrono::milliseconds delay, Callback callback) {
+            return schedule(delay, 0, std::move(callback));
+        }
+
+        TimerId runEvery(std::chrono::milliseconds interval, Callback callback) {
+            uint64_t ticks = toTicks(interval);
+            return schedule(interval, ticks == 0 ? 1 : ticks, std::move(callback));
+        }
+
+        bool cancel(TimerId id) {
+            // 不主动解除timerfd，多一次空唤醒的代价远小于重新扫描
+            return wheel_.cancel(id);
+        }
+
+        // timerfd可读时由Reactor调用
+        void handleExpired() {
+            uint64_t expirations;
+            while (read(timer_fd_, &expirations, sizeof(expirations)) > 0) {}
+            armed_tick_ = std::numeric_limits<uint64_t>::max();
+            wheel_.advanceTo(nowTick());
+            rearm(wheel_.nextExpiry());
+        }
+
+        size_t size() const { return wheel_.size(); }
+
+    private:
+        static int64_t monotonicNs() {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+
+        uint64_t nowTick() const {
+            return static_cast<uint64_t>((monotonicNs() - start_ns_) / tick_ns_);
+        }
+
+        uint64_t toTicks(std::chrono::milliseconds d) const {
+            int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+            if (ns <= 0) return 0;
+            return static_cast<uint64_t>((ns + tick_ns_ - 1) / tick_ns_);
+        }
+
+        TimerId schedule(std::chrono::milliseconds delay, uint64_t interval, Callback callback) {
+            uint64_t now = nowTick();
+            if (wheel_.size() == 0) {
+                // 时间轮为空时直接跳到当前时刻，避免追赶空转
+                wheel_.advanceTo(now);
+            }
+            // 当前tick已经过去了一部分，多等一个tick保证不会提前触发
+            uint64_t expire = now + toTicks(delay) + 1;
+            TimerId id = wheel_.scheduleAt(expire, interval, std::move(callback));
+            if (expire < armed_tick_) {
+                rearm(expire);
+            }
+            return id;
+        }
+
+        void rearm(uint64_t tick) {
+            struct itimerspec spec = {};
+            if (tick != std::numeric_limits<uint64_t>::max()) {
+                int64_t ns = start_ns_ + static_cast<int64_t>(tick) * tick_ns_;
+                spec.it_value.tv_sec = ns / 1000000000;
+                spec.it_value.tv_nsec = ns % 1000000000;
+            }
+            if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) == -1) {
+                throw std::runtime_error("Failed to arm timerfd");
+            }
+            armed_tick_ = tick;
+        }
+
+        TimingWheel wheel_;
+        int timer_fd_;
+        int64_t start_ns_;
+        int64_t tick_ns_;
+        uint64_t armed_tick_;
+};
+
+} // namespace trpc
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <time.h>
+
+#include "json.hpp"
+#include "metrics.hpp"
+
+/*
+    请求分阶段计时
+    +一个请求依次经过 read → decode → queue → cache → execute → encode → send 七个阶段，
+     RequestTrace记录每个阶段的耗时
+    +按ServerOptions::trace_sample_rate抽样，或客户端在请求中带"trace": true时记录；
+     未记录的请求mark()不读时钟
+    +带调试标记的请求在响应中附带send之前各阶段的耗时；所有记录的请求在发送完成后计入TraceStats
+*/
+namespace trpc {
+
+enum class Stage {
+    Read,       // 从socket读出请求
+    Decode,     // 切分帧、解析JSON、查找方法
+    Queue,      // 在线程池队列中等待；内联执行时为0
+    Cache,      // 查询Redis缓存；不走缓存的请求为0
+    Execute,    // 执行服务方法并序列化结果
+    Encode,     // 交回事件循环线程并编码响应帧
+    Send        // 写入socket直到发送完毕
+};
+
+constexpr size_t kStageCount = 7;
+constexpr const char* kStageNames[kStageCount] = {"read", "decode", "queue", "cache", "execute", "encode", "send"};
+
+// CLOCK_MONOTONIC经vDSO读取，不陷入内核
+inline uint64_t monotonicNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+struct RequestTrace {
+    bool enabled = false;
+    bool debug = false;                 // 客户端要求在响应中返回各阶段耗时
+    uint64_t last = 0;                  // 上一个阶段结束的时刻
+    uint64_t stages[kStageCount] = {};
+
+    // read阶段在请求解析之前就已结束，由调用方传入其耗时；since为decode阶段开始的时刻
+    void begin(uint64_t read_ns, uint64_t since, bool debug_flag) {
+        enabled = true;
+        debug = debug_flag;
+        stages[static_cast<size_t>(Stage::Read)] = read_ns;
+        last = since;
+    }
+
+    // 把从上一个阶段结束到现在的时间计入stage，可以多次累加
+    void mark(Stage stage) {
+        if (!enabled) return;
+        uint64_t now = monotonicNanos();
+        stages[static_cast<size_t>(stage)] += now - last;
+        last = now;
+    }
+
+    uint64_t total() const {
+        uint64_t sum = 0;
+        for (uint64_t ns : stages) sum += ns;
+        return sum;
+    }
+
+    // 各阶段耗时，单位微秒
+    nlohmann::json toJson() const {
+        nlohmann::json out;
+        for (size_t i = 0; i < kStageCount; ++i) out[kStageNames[i]] = stages[i] / 1e3;
+        out["total"] = total() / 1e3;
+        return out;
+    }
+};
+
+// 所有记录过的请求的各阶段耗时分布，可在任意线程写入和读取
+class TraceStats {
+    public:
+        void record(const RequestTrace& trace) {
+            for (size_t i = 0; i < kStageCount; ++i) stages_[i].record(trace.stages[i]);
+            total_.record(trace.total());
+        }
+
+        MetricHistogram stage(size_t index) const {
+            MetricHistogram out;
+            stages_[index].mergeInto(out);
+            return out;
+        }
+
+        MetricHistogram total() const {
+            MetricHistogram out;
+            total_.mergeInto(out);
+            return out;
+        }
+
+    private:
+        AtomicHistogram stages_[kStageCount];
+        AtomicHistogram total_;
+};
+
+} // namespace trpc